@@ -0,0 +1,218 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "AllocTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+// ----- STATE ----- //
+bool AllocTracker::s_strict = false;
+bool AllocTracker::s_steady = false;
+
+namespace
+{
+    struct TagCounters
+    {
+        const char* name;
+        std::atomic<size_t> allocations;
+        std::atomic<size_t> bytes_allocated;
+        std::atomic<size_t> live_bytes;
+    };
+
+    // tag 0 is everything allocated outside an AllocScope
+    TagCounters g_tags[AllocTracker::MAX_TAGS] = { { "untagged" } };
+    std::atomic<int> g_tag_count{ 1 };
+    std::mutex g_tag_mutex;
+
+    std::atomic<size_t> g_live_bytes{ 0 };
+    std::atomic<size_t> g_live_allocations{ 0 };
+    std::atomic<size_t> g_total_allocations{ 0 };
+
+    std::atomic<size_t> g_frame_allocations{ 0 };
+    std::atomic<size_t> g_frame_frees{ 0 };
+    std::atomic<size_t> g_frame_bytes{ 0 };
+
+    thread_local int t_current_tag = 0;
+}
+
+// ----- TAGS ----- //
+int AllocTracker::register_tag(const char* name)
+{
+    // fast path, tags are registered once and then only looked up
+    int count = g_tag_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++)
+    {
+        if (g_tags[i].name == name || strcmp(g_tags[i].name, name) == 0) return i;
+    }
+
+    std::lock_guard<std::mutex> lock(g_tag_mutex);
+    count = g_tag_count.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(g_tags[i].name, name) == 0) return i;
+    }
+    // out of slots so lump it in with untagged
+    if (count == MAX_TAGS) return 0;
+
+    g_tags[count].name = name;
+    g_tag_count.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+int AllocTracker::current_tag() { return t_current_tag; }
+void AllocTracker::set_current_tag(int tag) { t_current_tag = tag; }
+
+AllocScope::AllocScope(const char* tag) :
+    m_previous_tag(AllocTracker::current_tag())
+{
+    AllocTracker::set_current_tag(AllocTracker::register_tag(tag));
+}
+
+AllocScope::~AllocScope()
+{
+    AllocTracker::set_current_tag(m_previous_tag);
+}
+
+// ----- COUNTERS ----- //
+void AllocTracker::record_allocation(size_t size, int tag)
+{
+    g_live_bytes.fetch_add(size, std::memory_order_relaxed);
+    g_live_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_total_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    g_frame_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_frame_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    g_tags[tag].allocations.fetch_add(1, std::memory_order_relaxed);
+    g_tags[tag].bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+    g_tags[tag].live_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void AllocTracker::record_free(size_t size, int tag)
+{
+    g_live_bytes.fetch_sub(size, std::memory_order_relaxed);
+    g_live_allocations.fetch_sub(1, std::memory_order_relaxed);
+    g_frame_frees.fetch_add(1, std::memory_order_relaxed);
+    g_tags[tag].live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+size_t AllocTracker::live_bytes() { return g_live_bytes.load(std::memory_order_relaxed); }
+size_t AllocTracker::live_allocations() { return g_live_allocations.load(std::memory_order_relaxed); }
+size_t AllocTracker::total_allocations() { return g_total_allocations.load(std::memory_order_relaxed); }
+
+bool const AllocTracker::is_tracking()
+{
+#ifdef TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// ----- FRAMES ----- //
+void AllocTracker::begin_frame()
+{
+    g_frame_allocations.store(0, std::memory_order_relaxed);
+    g_frame_frees.store(0, std::memory_order_relaxed);
+    g_frame_bytes.store(0, std::memory_order_relaxed);
+}
+
+AllocFrameStats AllocTracker::end_frame()
+{
+    AllocFrameStats stats = {
+        g_frame_allocations.load(std::memory_order_relaxed),
+        g_frame_frees.load(std::memory_order_relaxed),
+        g_frame_bytes.load(std::memory_order_relaxed)
+    };
+
+    if (s_strict && s_steady && stats.allocations > 0)
+    {
+        LOG("ERROR: steady-state frame made " << stats.allocations << " allocations ("
+            << stats.bytes_allocated << " bytes)");
+        report();
+        // abort() doesn't flush
+        std::cout.flush();
+        std::abort();
+    }
+
+    return stats;
+}
+
+void AllocTracker::report()
+{
+    LOG("----- ALLOCATIONS ----- live: " << live_allocations() << " blocks, "
+        << live_bytes() << " bytes, total: " << total_allocations());
+
+    int count = g_tag_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++)
+    {
+        LOG("  " << g_tags[i].name
+            << " allocs: " << g_tags[i].allocations.load(std::memory_order_relaxed)
+            << " bytes: " << g_tags[i].bytes_allocated.load(std::memory_order_relaxed)
+            << " live: " << g_tags[i].live_bytes.load(std::memory_order_relaxed));
+    }
+}
+
+// ----- HOOKS ----- //
+#ifdef TRACK_ALLOCATIONS
+
+namespace
+{
+    // every block carries its size and tag in front so delete can un-count it,
+    // padded to keep the returned pointer at the default new alignment
+    struct alignas(alignof(std::max_align_t)) BlockHeader
+    {
+        size_t size;
+        int    tag;
+    };
+
+    void* tracked_alloc(size_t size)
+    {
+        BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+        if (header == nullptr) return nullptr;
+
+        header->size = size;
+        header->tag = t_current_tag;
+        AllocTracker::record_allocation(size, header->tag);
+        return header + 1;
+    }
+
+    void tracked_free(void* pointer)
+    {
+        if (pointer == nullptr) return;
+
+        BlockHeader* header = (BlockHeader*)pointer - 1;
+        AllocTracker::record_free(header->size, header->tag);
+        free(header);
+    }
+}
+
+void* operator new(size_t size)
+{
+    void* pointer = tracked_alloc(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    void* pointer = tracked_alloc(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return tracked_alloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return tracked_alloc(size); }
+
+void operator delete(void* pointer) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer) noexcept { tracked_free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { tracked_free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { tracked_free(pointer); }
+
+#endif // TRACK_ALLOCATIONS
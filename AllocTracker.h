@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+
+// Opt-in allocation tracking. Build with TRACK_ALLOCATIONS defined to hook the
+// global operator new/delete; without it every counter just stays at zero.
+//
+// Each allocation is charged to the tag of the innermost AllocScope on the
+// calling thread ("untagged" otherwise), so a frame can be broken down into
+// input / update / render and so on.
+
+struct AllocFrameStats
+{
+    size_t allocations;
+    size_t frees;
+    size_t bytes_allocated;
+};
+
+class AllocTracker
+{
+public:
+    static constexpr int MAX_TAGS = 16;
+
+    // frame bookkeeping, call once per loop iteration
+    static void begin_frame();
+    static AllocFrameStats end_frame();
+
+    // strict mode reports and aborts when a frame marked steady allocates,
+    // release builds included, so a run that allocates can't pass
+    static void set_strict(bool strict) { s_strict = strict; }
+    static bool is_strict() { return s_strict; }
+    static void set_steady_state(bool steady) { s_steady = steady; }
+    // false unless built with TRACK_ALLOCATIONS, strict mode can't see anything then
+    static bool const is_tracking();
+
+    static size_t live_bytes();
+    static size_t live_allocations();
+    static size_t total_allocations();
+
+    static void report();
+
+    // used by the hooks and AllocScope, not by game code
+    static int  register_tag(const char* name);
+    static int  current_tag();
+    static void set_current_tag(int tag);
+    static void record_allocation(size_t size, int tag);
+    static void record_free(size_t size, int tag);
+
+private:
+    static bool s_strict;
+    static bool s_steady;
+};
+
+// charges every allocation made during its lifetime to the given tag
+class AllocScope
+{
+private:
+    int m_previous_tag;
+
+public:
+    AllocScope(const char* tag);
+    ~AllocScope();
+};
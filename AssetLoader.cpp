@@ -0,0 +1,73 @@
+#include "AssetLoader.h"
+#include "stb_image.h"
+
+#include <chrono>
+
+AssetLoader::~AssetLoader()
+{
+    wait();
+    free_images();
+}
+
+void AssetLoader::start(const char* const* filepaths, int count)
+{
+    m_images.assign(count, DecodedImage());
+    for (int i = 0; i < count; i++)
+    {
+        m_images[i].filepath = filepaths[i];
+    }
+    m_next_image = 0;
+
+    // one thread per core but never more threads than images
+    int worker_count = (int)std::thread::hardware_concurrency();
+    if (worker_count < 1) worker_count = 1;
+    if (worker_count > count) worker_count = count;
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        m_workers.emplace_back(&AssetLoader::decode_worker, this);
+    }
+}
+
+void AssetLoader::decode_worker()
+{
+    // each worker keeps grabbing the next undecoded image until there are none left
+    for (int index = m_next_image++; index < (int)m_images.size(); index = m_next_image++)
+    {
+        DecodedImage& image = m_images[index];
+        auto start = std::chrono::steady_clock::now();
+
+        int width, height, number_of_components;
+        unsigned char* pixels = stbi_load(image.filepath, &width, &height,
+            &number_of_components, STBI_rgb_alpha);
+
+        image.loaded = pixels != NULL;
+        if (image.loaded)
+        {
+            // shrinking to a palette here keeps it off the GL thread too
+            encode_texture(pixels, width, height, true, image.texture);
+            stbi_image_free(pixels);
+        }
+
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        image.decode_ms = elapsed.count();
+    }
+}
+
+void AssetLoader::wait()
+{
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+    m_workers.clear();
+}
+
+void AssetLoader::free_images()
+{
+    for (size_t i = 0; i < m_images.size(); i++)
+    {
+        // swap with an empty vector to actually give the memory back
+        std::vector<unsigned char>().swap(m_images[i].texture.pixels);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "TextureEncoding.h"
+
+// A decoded image sitting in memory, waiting to be uploaded on the GL thread
+struct DecodedImage
+{
+    const char*    filepath;
+    bool           loaded;          // false if decoding failed
+    EncodedTexture texture;         // already shrunk to the smallest format
+    float          decode_ms;
+};
+
+// Decodes a batch of PNGs on worker threads so the main thread can set up the
+// window, context and shaders in the meantime. Nothing in here touches GL.
+class AssetLoader
+{
+private:
+    std::vector<DecodedImage> m_images;
+    std::vector<std::thread>  m_workers;
+    std::atomic<int>          m_next_image{ 0 };
+
+    void decode_worker();
+
+public:
+    ~AssetLoader();
+
+    // kicks off decoding right away, returns without waiting
+    void start(const char* const* filepaths, int count);
+    // blocks until every image has been decoded
+    void wait();
+    // releases the encoded pixels once they have been uploaded
+    void free_images();
+
+    DecodedImage const& get_image(int index) const { return m_images[index]; }
+    int          const  get_count()          const { return (int)m_images.size(); }
+};
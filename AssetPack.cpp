@@ -0,0 +1,163 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "AssetPack.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+#ifdef _WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t MAX_TEXTURE_SIDE = 16384;
+
+    // everything the uploader and ShaderProgram::register_texture will trust
+    bool is_valid_entry(const AssetPackEntry& entry, size_t pack_size)
+    {
+        if (entry.format > TEXTURE_MASK1) return false;
+        if (entry.width == 0 || entry.height == 0 || entry.width > MAX_TEXTURE_SIDE || entry.height > MAX_TEXTURE_SIDE) return false;
+        if (entry.palette_size > MAX_PALETTE_COLOURS) return false;
+        if (entry.size != texture_data_size((TextureFormat)entry.format, (int)entry.width, (int)entry.height)) return false;
+        return entry.offset <= pack_size && entry.size <= pack_size - entry.offset;
+    }
+}
+
+bool get_source_stamp(const char* filepath, uint64_t& size, int64_t& modified)
+{
+    struct stat file_stat;
+    if (stat(filepath, &file_stat) != 0) return false;
+
+    size = (uint64_t)file_stat.st_size;
+    modified = (int64_t)file_stat.st_mtime;
+    return true;
+}
+
+AssetPack::~AssetPack()
+{
+    close();
+}
+
+bool AssetPack::open(const char* filepath)
+{
+    close();
+
+#ifdef _WINDOWS
+    HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    m_size = (size_t)file_size.QuadPart;
+#else
+    int file = ::open(filepath, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping keeps its own reference to the file
+    ::close(file);
+    if (mapping == MAP_FAILED) return false;
+
+    m_data = (const unsigned char*)mapping;
+    m_size = (size_t)file_stat.st_size;
+#endif
+
+    if (m_data == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    // sanity check the header and every entry before anyone reads through them
+    const AssetPackHeader* header = (const AssetPackHeader*)m_data;
+    if (m_size < sizeof(AssetPackHeader) || header->magic != ASSET_PACK_MAGIC ||
+        header->version != ASSET_PACK_VERSION ||
+        m_size < sizeof(AssetPackHeader) + header->entry_count * sizeof(AssetPackEntry))
+    {
+        close();
+        return false;
+    }
+
+    const AssetPackEntry* entries = (const AssetPackEntry*)(header + 1);
+    for (uint32_t i = 0; i < header->entry_count; i++)
+    {
+        if (!is_valid_entry(entries[i], m_size))
+        {
+            LOG("Asset pack " << filepath << " has a broken entry for " << std::string(entries[i].name,
+                strnlen(entries[i].name, ASSET_PACK_NAME_LENGTH)) << ", ignoring the pack");
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void AssetPack::close()
+{
+#ifdef _WINDOWS
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) CloseHandle((HANDLE)m_mapping);
+    if (m_file != nullptr) CloseHandle((HANDLE)m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data != nullptr) munmap((void*)m_data, m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const AssetPackEntry* AssetPack::find(const char* name) const
+{
+    if (m_data == nullptr) return nullptr;
+
+    const AssetPackHeader* header = (const AssetPackHeader*)m_data;
+    const AssetPackEntry* entries = (const AssetPackEntry*)(header + 1);
+
+    for (uint32_t i = 0; i < header->entry_count; i++)
+    {
+        if (strncmp(entries[i].name, name, ASSET_PACK_NAME_LENGTH) == 0) return &entries[i];
+    }
+    return nullptr;
+}
+
+bool AssetPack::is_current(const AssetPackEntry* entry) const
+{
+    char name[ASSET_PACK_NAME_LENGTH + 1] = {};
+    memcpy(name, entry->name, ASSET_PACK_NAME_LENGTH);
+
+    uint64_t size;
+    int64_t modified;
+    if (!get_source_stamp(name, size, modified)) return true;
+    return size == entry->source_size && modified == entry->source_modified;
+}
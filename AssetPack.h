@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "TextureEncoding.h"
+
+// ----- PACK FORMAT ----- //
+// A pack is one header, then entry_count entries, then the pixel data of every
+// entry. Pixel data is stored exactly the way glTexImage2D wants it (RGBA,
+// palette indices or a 1-bit mask), so the loader can hand GL a pointer
+// straight into the mapping. Built offline by tools/pack_assets.cpp.
+//
+// Each entry also remembers the size and modification time of the PNG it came
+// from, so a pack that's older than its sources doesn't get used.
+
+constexpr uint32_t ASSET_PACK_MAGIC = 0x4B504C4C; // "LLPK"
+constexpr uint32_t ASSET_PACK_VERSION = 3;
+constexpr size_t   ASSET_PACK_NAME_LENGTH = 64;
+constexpr size_t   ASSET_PACK_ALIGNMENT = 16;
+
+struct AssetPackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+};
+
+struct AssetPackEntry
+{
+    char     name[ASSET_PACK_NAME_LENGTH]; // the path the PNG was packed from
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;                       // TextureFormat
+    uint32_t palette_size;
+    uint64_t offset;                       // from the start of the file
+    uint64_t size;
+    uint64_t source_size;                  // of the PNG when it was packed
+    int64_t  source_modified;              // seconds since the epoch
+    uint8_t  palette[MAX_PALETTE_COLOURS][4];
+};
+
+// size and modification time of a file on disk, false if it can't be read
+bool get_source_stamp(const char* filepath, uint64_t& size, int64_t& modified);
+
+// Read-only view of a pack file, memory mapped so nothing is copied on load
+class AssetPack
+{
+private:
+    const unsigned char* m_data = nullptr;
+    size_t               m_size = 0;
+
+#ifdef _WINDOWS
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+
+public:
+    ~AssetPack();
+
+    // false if the file is missing, is not a pack this build understands or
+    // has any entry that doesn't add up (format, size, palette, offsets)
+    bool open(const char* filepath);
+    void close();
+
+    const AssetPackEntry* find(const char* name) const;
+    // false once the PNG the entry was packed from has changed. A PNG that's
+    // gone leaves the pack as the only copy, so that counts as current
+    bool                  is_current(const AssetPackEntry* entry) const;
+    const unsigned char*  get_pixels(const AssetPackEntry* entry) const { return m_data + entry->offset; }
+    bool                  is_open()                               const { return m_data != nullptr; }
+};
@@ -0,0 +1,384 @@
+#include "BinaryLog.h"
+#include "SpscQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int MAX_THREADS = 256;                // LogRecord::thread is a byte
+    constexpr int IDLE_SLEEP_MS = 2;                // writer's nap when every ring is empty
+
+    struct ThreadRing
+    {
+        SpscQueue<LogRecord, BinaryLog::RING_CAPACITY> queue;
+        std::atomic<uint64_t> dropped{ 0 };         // by the owning thread when the queue is full
+        uint64_t              reported = 0;         // writer only, dropped as of the last marker
+        uint8_t               thread;
+    };
+
+    struct FormatEntry
+    {
+        const char* format;
+        const char* file;
+        int         line;
+    };
+
+    // rings are published through the count so the writer can walk them without the lock
+    std::mutex               g_rings_mutex;
+    ThreadRing*              g_rings[MAX_THREADS];  // never freed, a thread's records outlive it
+    std::atomic<int>         g_ring_count{ 0 };
+    std::atomic<uint64_t>    g_ringless_dropped{ 0 };
+    thread_local ThreadRing* t_ring = nullptr;
+
+    std::mutex               g_formats_mutex;
+    std::vector<FormatEntry> g_formats;
+
+    std::atomic<bool>     g_running{ false };
+    std::atomic<bool>     g_stopping{ false };
+    std::atomic<uint64_t> g_written{ 0 };
+    std::thread           g_writer;
+    FILE*                 g_file = nullptr;         // null formats to stdout
+    size_t                g_formats_written = 0;    // writer only
+    std::vector<LogRecord> g_batch;                 // writer only
+
+    ThreadRing* get_ring()
+    {
+        if (t_ring == nullptr)
+        {
+            // first record on this thread, the only time logging allocates
+            std::lock_guard<std::mutex> lock(g_rings_mutex);
+            int count = g_ring_count.load(std::memory_order_relaxed);
+            if (count == MAX_THREADS) return nullptr;
+
+            ThreadRing* ring = new ThreadRing();
+            ring->thread = (uint8_t)count;
+            g_rings[count] = ring;
+            g_ring_count.store(count + 1, std::memory_order_release);
+            t_ring = ring;
+        }
+        return t_ring;
+    }
+
+    // ----- WRITER ----- //
+    void put_entry(const void* data, size_t size)
+    {
+        fwrite(data, 1, size, g_file);
+    }
+
+    void write_new_formats()
+    {
+        std::lock_guard<std::mutex> lock(g_formats_mutex);
+        for (; g_formats_written < g_formats.size(); g_formats_written++)
+        {
+            const FormatEntry& entry = g_formats[g_formats_written];
+            if (g_file == nullptr) continue;
+
+            uint8_t kind = LOG_ENTRY_FORMAT;
+            uint32_t id = (uint32_t)g_formats_written;
+            uint32_t line = (uint32_t)entry.line;
+            uint16_t file_length = (uint16_t)std::min<size_t>(strlen(entry.file), 0xFFFF);
+            uint16_t format_length = (uint16_t)std::min<size_t>(strlen(entry.format), 0xFFFF);
+            put_entry(&kind, 1);
+            put_entry(&id, 4);
+            put_entry(&line, 4);
+            put_entry(&file_length, 2);
+            put_entry(&format_length, 2);
+            put_entry(entry.file, file_length);
+            put_entry(entry.format, format_length);
+        }
+    }
+
+    void write_dropped(uint32_t thread, uint64_t count)
+    {
+        if (g_file == nullptr)
+        {
+            fprintf(stdout, "%12s [t%u] %llu records dropped\n", "", thread, (unsigned long long)count);
+            return;
+        }
+        uint8_t kind = LOG_ENTRY_DROPPED;
+        put_entry(&kind, 1);
+        put_entry(&thread, 4);
+        put_entry(&count, 8);
+    }
+
+    void write_record(const LogRecord& record)
+    {
+        if (g_file != nullptr)
+        {
+            uint8_t kind = LOG_ENTRY_RECORD;
+            put_entry(&kind, 1);
+            put_entry(&record, sizeof(record));
+            return;
+        }
+
+        const char* format;
+        {
+            std::lock_guard<std::mutex> lock(g_formats_mutex);
+            format = g_formats[record.format_id].format;
+        }
+        char text[512];
+        BinaryLog::format(format, record, text, sizeof(text));
+        fprintf(stdout, "%12.6f [t%u] %s\n", record.time_ns / 1e9, record.thread, text);
+    }
+
+    // returns how many records it wrote
+    size_t drain()
+    {
+        // Take everything that's there now, then merge the threads by time.
+        // A record only gets pushed after its format is registered, so once
+        // it's been seen here its format is already in the table
+        g_batch.clear();
+        int ring_count = g_ring_count.load(std::memory_order_acquire);
+        for (int i = 0; i < ring_count; i++)
+        {
+            ThreadRing* ring = g_rings[i];
+            for (size_t n = ring->queue.get_size(); n > 0; n--)
+            {
+                g_batch.push_back(*ring->queue.peek());
+                ring->queue.pop();
+            }
+        }
+        std::sort(g_batch.begin(), g_batch.end(), [](const LogRecord& a, const LogRecord& b)
+        {
+            return a.time_ns < b.time_ns || (a.time_ns == b.time_ns && a.thread < b.thread);
+        });
+
+        write_new_formats();
+        for (int i = 0; i < ring_count; i++)
+        {
+            ThreadRing* ring = g_rings[i];
+            uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+            if (dropped != ring->reported)
+            {
+                write_dropped(ring->thread, dropped - ring->reported);
+                ring->reported = dropped;
+            }
+        }
+        for (size_t i = 0; i < g_batch.size(); i++)
+        {
+            write_record(g_batch[i]);
+        }
+
+        g_written.fetch_add(g_batch.size(), std::memory_order_relaxed);
+        return g_batch.size();
+    }
+
+    void writer()
+    {
+        TRACE_THREAD_NAME("binary log");
+        while (true)
+        {
+            // checked before draining, so everything pushed before shutdown() gets out
+            bool stopping = g_stopping.load(std::memory_order_acquire);
+            if (drain() == 0)
+            {
+                if (stopping) break;
+                if (g_file != nullptr) fflush(g_file);
+                std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_SLEEP_MS));
+            }
+        }
+
+        uint64_t ringless = g_ringless_dropped.exchange(0);
+        if (ringless > 0) write_dropped(MAX_THREADS, ringless);
+        if (g_file != nullptr)
+        {
+            fclose(g_file);
+            g_file = nullptr;
+        }
+        else
+        {
+            fflush(stdout);
+        }
+    }
+}
+
+bool BinaryLog::start(const char* filepath)
+{
+    if (g_running) return true;
+
+    if (filepath != nullptr)
+    {
+        g_file = fopen(filepath, "wb");
+        if (g_file == nullptr) return false;
+
+        setvbuf(g_file, nullptr, _IOFBF, 1 << 16);
+        uint32_t header[3] = { FILE_MAGIC, FILE_VERSION, (uint32_t)sizeof(LogRecord) };
+        fwrite(header, sizeof(header), 1, g_file);
+    }
+
+    // every format is written again to the new file
+    g_formats_written = 0;
+    g_written = 0;
+    g_batch.reserve(RING_CAPACITY * 4);
+    g_stopping = false;
+    g_writer = std::thread(writer);
+    g_running = true;
+    return true;
+}
+
+void BinaryLog::shutdown()
+{
+    if (!g_running) return;
+
+    g_running = false;
+    g_stopping.store(true, std::memory_order_release);
+    g_writer.join();
+}
+
+bool const BinaryLog::is_running()
+{
+    return g_running.load(std::memory_order_relaxed);
+}
+
+uint64_t const BinaryLog::get_written()
+{
+    return g_written.load(std::memory_order_relaxed);
+}
+
+uint64_t const BinaryLog::get_dropped()
+{
+    uint64_t dropped = g_ringless_dropped.load(std::memory_order_relaxed);
+    int ring_count = g_ring_count.load(std::memory_order_acquire);
+    for (int i = 0; i < ring_count; i++)
+    {
+        dropped += g_rings[i]->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+uint32_t BinaryLog::register_format(const char* format, const char* file, int line)
+{
+    // only the file name, full build paths just make the log bigger
+    const char* name = file;
+    for (const char* c = file; *c != '\0'; c++)
+    {
+        if (*c == '/' || *c == '\\') name = c + 1;
+    }
+
+    std::lock_guard<std::mutex> lock(g_formats_mutex);
+    g_formats.push_back({ format, name, line });
+    return (uint32_t)g_formats.size() - 1;
+}
+
+void BinaryLog::push(LogRecord& record)
+{
+    ThreadRing* ring = get_ring();
+    if (ring == nullptr)
+    {
+        g_ringless_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    record.thread = ring->thread;
+    if (!ring->queue.push(record)) ring->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ----- FORMATTING ----- //
+namespace
+{
+    // snprintf's rules: keeps counting past the end so the caller can tell it got cut short
+    struct FormatOutput
+    {
+        char*  out;
+        size_t size;
+        size_t length;
+
+        void put(char c)
+        {
+            if (length + 1 < size) out[length] = c;
+            length++;
+        }
+
+        template <typename T>
+        void print(const char* spec, T value)
+        {
+            bool room = length < size;
+            int written = snprintf(room ? out + length : nullptr, room ? size - length : 0, spec, value);
+            if (written > 0) length += written;
+        }
+    };
+}
+
+int BinaryLog::format(const char* format, const LogRecord& record, char* out, size_t size)
+{
+    FormatOutput output = { out, size, 0 };
+    int argument = 0;
+    char spec[32];
+
+    const char* c = format;
+    while (*c != '\0')
+    {
+        if (*c != '%')
+        {
+            output.put(*c++);
+            continue;
+        }
+        if (c[1] == '%')
+        {
+            output.put('%');
+            c += 2;
+            continue;
+        }
+
+        // keep flags, width and precision, length modifiers get replaced to
+        // suit whatever the argument really is
+        size_t spec_length = 0;
+        spec[spec_length++] = *c++;
+        while (*c != '\0' && strchr("-+ #0123456789.", *c) != nullptr)
+        {
+            if (spec_length < 24) spec[spec_length++] = *c;
+            c++;
+        }
+        while (*c != '\0' && strchr("hlLqjzt", *c) != nullptr) c++;
+        char conversion = *c != '\0' ? *c++ : 'd';
+
+        if (argument >= record.argument_count)
+        {
+            for (const char* missing = "<missing>"; *missing != '\0'; missing++) output.put(*missing);
+            continue;
+        }
+
+        LogArgumentType type = record.get_type(argument);
+        double as_float = type == LOG_ARGUMENT_FLOAT ? record.arguments[argument].f
+            : type == LOG_ARGUMENT_INT ? (double)record.arguments[argument].i : (double)record.arguments[argument].u;
+        long long as_int = type == LOG_ARGUMENT_FLOAT ? (long long)record.arguments[argument].f
+            : (long long)record.arguments[argument].i;
+        argument++;
+
+        if (strchr("fFeEgGaA", conversion) != nullptr)
+        {
+            spec[spec_length++] = conversion;
+            spec[spec_length] = '\0';
+            output.print(spec, as_float);
+        }
+        else if (strchr("diuxXoc", conversion) != nullptr)
+        {
+            if (conversion != 'c')
+            {
+                spec[spec_length++] = 'l';
+                spec[spec_length++] = 'l';
+            }
+            spec[spec_length++] = conversion;
+            spec[spec_length] = '\0';
+            if (conversion == 'c') output.print(spec, (int)as_int);
+            else output.print(spec, as_int);
+        }
+        else
+        {
+            // %s, %p and the like can't have come through as numbers, show the value plainly
+            if (type == LOG_ARGUMENT_FLOAT) output.print("%g", as_float);
+            else if (type == LOG_ARGUMENT_UINT) output.print("%llu", (unsigned long long)as_int);
+            else output.print("%lld", as_int);
+        }
+    }
+
+    if (size > 0) out[output.length < size ? output.length : size - 1] = '\0';
+    return (int)output.length;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "Trace.h"
+
+// Logging that's cheap enough to leave on every tick. BINLOG("x %.2f", x)
+// copies the timestamp, a format id and the arguments into a fixed 64 byte
+// record on the calling thread's own ring and returns. A background thread
+// drains the rings and either writes the records to a binary file as they are,
+// or formats them printf style to stdout when there's no file. tools/log_decode
+// turns a file back into text.
+//
+// Formats have to be string literals, they're registered once per call site.
+// Arguments are numbers only (integers, floats, bools and enums), up to six
+// of them. When a ring fills because the writer can't keep up, records are
+// dropped and counted rather than waiting, and the file says where.
+//
+// Files are native endian:
+//   header                  "LLBL", version, record size (all uint32)
+//   then entries, each a uint8 kind followed by
+//     LOG_ENTRY_FORMAT      uint32 id, uint32 line, uint16 file length, uint16 format length, file, format
+//     LOG_ENTRY_RECORD      a LogRecord
+//     LOG_ENTRY_DROPPED     uint32 thread, uint64 records dropped since the last one
+
+enum LogArgumentType { LOG_ARGUMENT_INT, LOG_ARGUMENT_UINT, LOG_ARGUMENT_FLOAT };
+enum LogEntryKind { LOG_ENTRY_FORMAT = 1, LOG_ENTRY_RECORD = 2, LOG_ENTRY_DROPPED = 3 };
+
+struct LogRecord
+{
+    static constexpr int MAX_ARGUMENTS = 6;
+
+    uint64_t time_ns;           // Trace::now(), so it lines up with trace zones
+    uint32_t format_id;
+    uint16_t argument_types;    // 2 bits an argument, LogArgumentType
+    uint8_t  thread;            // order each thread first logged in
+    uint8_t  argument_count;
+    union
+    {
+        int64_t  i;
+        uint64_t u;
+        double   f;
+    } arguments[MAX_ARGUMENTS];
+
+    LogArgumentType const get_type(int index) const { return (LogArgumentType)((argument_types >> (index * 2)) & 3); }
+};
+static_assert(sizeof(LogRecord) == 64, "records are written to disk as they are");
+
+class BinaryLog
+{
+public:
+    static constexpr uint32_t FILE_MAGIC = 0x4C424C4C;     // "LLBL"
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr size_t   RING_CAPACITY = 1 << 12;     // records per thread, power of two
+
+    // filepath nullptr formats to stdout instead. Returns false if the file
+    // couldn't be opened. Nothing is logged until this has been called
+    static bool start(const char* filepath);
+    // writes out whatever is still in the rings
+    static void shutdown();
+
+    static bool const is_running();
+    static uint64_t const get_written();
+    static uint64_t const get_dropped();
+
+    // once per call site, the BINLOG macro keeps the id in a static
+    static uint32_t register_format(const char* format, const char* file, int line);
+
+    // printf style, each conversion takes the next argument whatever its type.
+    // Returns the length like snprintf
+    static int format(const char* format, const LogRecord& record, char* out, size_t size);
+
+    template <typename... Arguments>
+    static void write(uint32_t format_id, Arguments... arguments)
+    {
+        static_assert(sizeof...(Arguments) <= LogRecord::MAX_ARGUMENTS, "too many arguments for one record");
+        if (!is_running()) return;
+
+        LogRecord record;
+        record.time_ns = Trace::now();
+        record.format_id = format_id;
+        record.argument_types = 0;
+        record.argument_count = (uint8_t)sizeof...(Arguments);
+        set_arguments(record, 0, arguments...);
+        push(record);
+    }
+
+private:
+    static void push(LogRecord& record);
+
+    static void set_arguments(LogRecord&, int) {}
+
+    template <typename T, typename... Rest>
+    static void set_arguments(LogRecord& record, int index, T value, Rest... rest)
+    {
+        set_argument(record, index, value);
+        set_arguments(record, index + 1, rest...);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type
+        set_argument(LogRecord& record, int index, T value)
+    {
+        record.arguments[index].f = (double)value;
+        record.argument_types |= LOG_ARGUMENT_FLOAT << (index * 2);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+        set_argument(LogRecord& record, int index, T value)
+    {
+        record.arguments[index].i = (int64_t)value;
+        record.argument_types |= LOG_ARGUMENT_INT << (index * 2);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+        set_argument(LogRecord& record, int index, T value)
+    {
+        record.arguments[index].u = (uint64_t)value;
+        record.argument_types |= LOG_ARGUMENT_UINT << (index * 2);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_enum<T>::value>::type
+        set_argument(LogRecord& record, int index, T value)
+    {
+        record.arguments[index].i = (int64_t)value;
+        record.argument_types |= LOG_ARGUMENT_INT << (index * 2);
+    }
+};
+
+#define BINLOG(format, ...) do { \
+        static const uint32_t binlog_format_id = BinaryLog::register_format(format, __FILE__, __LINE__); \
+        BinaryLog::write(binlog_format_id, ##__VA_ARGS__); \
+    } while (0)
@@ -24,7 +24,11 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
 #include "Entity.h"
+#include "Trace.h"
+#include "BinaryLog.h"
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 // Default constructor
@@ -160,6 +164,8 @@ void Entity::update(float delta_time, Entity* collidable_entities, int collidabl
     if (m_enemy) {
         if (m_position.x < -6.0f)
         {
+            // carry the previous pose across the wrap so it doesn't get drawn sweeping back
+            m_previous_position.x += 12.0f;
             m_position.x = 6.0f;
         }
     }
@@ -171,15 +177,32 @@ void Entity::update(float delta_time, Entity* collidable_entities, int collidabl
     m_model_matrix = glm::scale(m_model_matrix, m_scale);
 }
 
-void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint texture_id, int index)
+// CPU half of drawing: works out the matrix and UVs without touching GL, so it
+// can run on any thread
+void Entity::build_sprite(const EntitySnapshot& snapshot, float alpha, SpriteDraw& sprite)
 {
+    if (alpha > 1.0f) alpha = 1.0f;
+
+    // everything rotates about z
+    sprite.model_matrix = glm::mat4(1.0f);
+    sprite.model_matrix = glm::translate(sprite.model_matrix, glm::mix(snapshot.previous_position, snapshot.position, alpha));
+    sprite.model_matrix = glm::rotate(sprite.model_matrix, glm::radians(glm::mix(snapshot.previous_angle, snapshot.angle, alpha)),
+        glm::vec3(0.0f, 0.0f, 1.0f));
+    sprite.model_matrix = glm::scale(sprite.model_matrix, snapshot.scale);
+    sprite.texture_id = snapshot.texture_id;
+
+    // no atlas is just an atlas with one frame
+    int index = snapshot.atlas_index >= 0 ? snapshot.atlas_index : 0;
+    int cols = snapshot.atlas_index >= 0 ? snapshot.atlas_cols : 1;
+    int rows = snapshot.atlas_index >= 0 ? snapshot.atlas_rows : 1;
+
     // Step 1: Calculate the UV location of the indexed frame
-    float u_coord = (float)(index % m_animation_cols) / (float)m_animation_cols;
-    float v_coord = (float)(index / m_animation_cols) / (float)m_animation_rows;
+    float u_coord = (float)(index % cols) / (float)cols;
+    float v_coord = (float)(index / cols) / (float)rows;
 
     // Step 2: Calculate its UV size
-    float width = 1.0f / (float)m_animation_cols;
-    float height = 1.0f / (float)m_animation_rows;
+    float width = 1.0f / (float)cols;
+    float height = 1.0f / (float)rows;
 
     // Step 3: Just as we have done before, match the texture coordinates to the vertices
     float tex_coords[] =
@@ -187,20 +210,25 @@ void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint textu
         u_coord, v_coord + height, u_coord + width, v_coord + height, u_coord + width, v_coord,
         u_coord, v_coord + height, u_coord + width, v_coord, u_coord, v_coord
     };
+    memcpy(sprite.tex_coords, tex_coords, sizeof(tex_coords));
+}
 
+// GL half, main thread only
+void Entity::draw_sprite(ShaderProgram* program, const SpriteDraw& sprite)
+{
     float vertices[] =
     {
         -0.5, -0.5, 0.5, -0.5,  0.5, 0.5,
         -0.5, -0.5, 0.5,  0.5, -0.5, 0.5
     };
 
-    // Step 4: And render
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+    program->set_model_matrix(sprite.model_matrix);
+    program->bind_texture(sprite.texture_id);
 
     glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
     glEnableVertexAttribArray(program->get_position_attribute());
 
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
+    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, sprite.tex_coords);
     glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
 
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -216,31 +244,46 @@ void Entity::set_animation_state(int num)
     m_animation_indices = m_animations[num].data();
 }
 
-
-void Entity::render(ShaderProgram* program)
+// rewind to the first frame, used when a pooled bubble is spawned again
+void Entity::reset_animation()
 {
-    program->set_model_matrix(m_model_matrix);
-
-    if (m_animation_indices != NULL)
-    {
-        draw_sprite_from_texture_atlas(program, m_texture_id, m_animation_indices[m_animation_index]);
-        return;
-    }
+    m_animation_index = 0;
+    m_animation_time = 1.0f;
+}
 
-    float vertices[] = { -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, -0.5, 0.5, 0.5, -0.5, 0.5 };
-    float tex_coords[] = { 0.0,  1.0, 1.0,  1.0, 1.0, 0.0,  0.0,  1.0, 1.0, 0.0,  0.0, 0.0 };
 
-    glBindTexture(GL_TEXTURE_2D, m_texture_id);
+void Entity::store_previous_transform()
+{
+    m_previous_position = m_position;
+    m_previous_angle = m_angle;
+}
 
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+EntitySnapshot Entity::get_snapshot() const
+{
+    EntitySnapshot snapshot;
+    snapshot.previous_position = m_previous_position;
+    snapshot.position = m_position;
+    snapshot.scale = m_scale;
+    snapshot.previous_angle = m_previous_angle;
+    snapshot.angle = m_angle;
+    snapshot.texture_id = m_texture_id;
+    snapshot.atlas_index = m_animation_indices != NULL ? m_animation_indices[m_animation_index] : -1;
+    snapshot.atlas_cols = m_animation_cols;
+    snapshot.atlas_rows = m_animation_rows;
+    return snapshot;
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+void Entity::render(ShaderProgram* program, float alpha)
+{
+    render(program, get_snapshot(), alpha);
+}
 
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+// only reads the snapshot, so it is safe while the simulation thread moves the real entity
+void Entity::render(ShaderProgram* program, const EntitySnapshot& snapshot, float alpha)
+{
+    SpriteDraw sprite;
+    build_sprite(snapshot, alpha, sprite);
+    draw_sprite(program, sprite);
 }
 
 void Entity::rotate(float delta_time, AngleDirection direction) 
@@ -254,8 +297,24 @@ void Entity::rotate(float delta_time, AngleDirection direction)
 }
 
 
-void Entity::update_fuel(float delta_time, bool using_fuel, std::vector<Entity*>& bubbles, GLuint texture_id)
+Entity* Entity::new_bubble(GLuint texture_id)
+{
+    return new Entity(
+        texture_id,                         // texture
+        1.0f,                               // speed
+        glm::vec3(0.0f, 0.5f, 0.0f),        // movement vector
+        { { 0, 1, 2, 3, 4, 5, 6, 7 } },     // animations
+        8,                                  // num frames
+        0,                                  // index
+        8,                                  // cols
+        1                                   // rows
+    );
+}
+
+void Entity::update_fuel(float delta_time, bool using_fuel, std::vector<Entity*>& bubbles,
+    std::vector<Entity*>& bubble_pool, GLuint texture_id)
 {
+    TRACE_ZONE("particles");
     // reset acceleration matrix
     m_acceleration = glm::vec3(0.0f);
     if (using_fuel && m_fuel > 0) {
@@ -265,16 +324,18 @@ void Entity::update_fuel(float delta_time, bool using_fuel, std::vector<Entity*>
 
         if (m_fuel % 20 == 0)
         {
-            Entity* bubble = new Entity(
-                texture_id,                // texture
-                1.0f,                               // speed
-                glm::vec3(0.0f, 0.5f, 0.0f),        // movement vector
-                { { 0, 1, 2, 3, 4, 5, 6, 7 } },     // animations
-                8,                                  // num frames
-                0,                                  // index
-                8,                                  // cols
-                1                                   // rows
-            );
+            Entity* bubble;
+            // reuse a popped bubble if there is one, only allocate when the pool is dry
+            if (!bubble_pool.empty())
+            {
+                bubble = bubble_pool.back();
+                bubble_pool.pop_back();
+                bubble->reset_animation();
+            }
+            else
+            {
+                bubble = new_bubble(texture_id);
+            }
 
             glm::vec3 temp_position = this->get_position();
             float temp_angle = this->get_angle();
@@ -295,6 +356,7 @@ void Entity::update_fuel(float delta_time, bool using_fuel, std::vector<Entity*>
             bubble->set_position(glm::vec3(new_x, new_y, 1.0f));
             bubble->set_scale(glm::vec3(0.2f, 0.2f, 1.0f));
             bubble->update(0.0f, nullptr, 0);
+            bubble->store_previous_transform();
             bubbles.push_back(bubble);
         }
 
@@ -313,13 +375,13 @@ void Entity::set_dimensions(float x, float y) {
 
 // ----- COLLISION STUFF ----- //
 
-std::vector<glm::vec2> Entity::get_corners()
+std::array<glm::vec2, 4> Entity::get_corners()
 {
-    std::vector<glm::vec2> corners;
+    std::array<glm::vec2, 4> corners;
     float half_width = m_width / 2.0f;
     float half_height = m_height / 2.0f;
 
-    std::vector<glm::vec2> local_corners = {
+    const glm::vec2 local_corners[4] = {
         {-half_width,  half_height},        // Top-left
         { half_width,  half_height},        // Top-right
         { half_width, -half_height},        // Bottom-right
@@ -330,47 +392,42 @@ std::vector<glm::vec2> Entity::get_corners()
     float cos_theta = glm::cos(angle_rad);
     float sin_theta = glm::sin(angle_rad);
 
-    for (auto& vertex : local_corners)
+    for (size_t i = 0; i < corners.size(); i++)
     {
-        float local_x = vertex.x;
-        float local_y = vertex.y;
+        float local_x = local_corners[i].x;
+        float local_y = local_corners[i].y;
 
         float rotated_x = cos_theta * local_x - sin_theta * local_y;
         float rotated_y = sin_theta * local_x + cos_theta * local_y;
 
-        corners.push_back(glm::vec2(m_position.x + rotated_x, m_position.y + rotated_y));
+        corners[i] = glm::vec2(m_position.x + rotated_x, m_position.y + rotated_y);
     }
 
     return corners;
 }
 
-std::vector<glm::vec2> Entity::get_edges()
+std::array<glm::vec2, 4> Entity::get_edges()
 {
-    std::vector<glm::vec2> corners = get_corners();
-    std::vector<glm::vec2> edges;
+    std::array<glm::vec2, 4> corners = get_corners();
+    std::array<glm::vec2, 4> edges;
 
     for (size_t i = 0; i < corners.size(); i++)
     {
-        edges.push_back(corners[(i + 1) % corners.size()] - corners[i]);
+        edges[i] = corners[(i + 1) % corners.size()] - corners[i];
     }
 
     return edges;
 }
 
-std::vector<glm::vec2> Entity::get_normals()
+std::array<glm::vec2, 4> Entity::get_normals()
 {
-    std::vector<glm::vec2> edges = get_edges();
-    std::vector<glm::vec2> normals;
-
-    for (auto& edge : edges)
-    {
-        normals.push_back(glm::vec2(-edge.y, edge.x));  
-    }
+    std::array<glm::vec2, 4> edges = get_edges();
+    std::array<glm::vec2, 4> normals;
 
-    // Normalize all the normals
-    for (auto& normal : normals)
+    for (size_t i = 0; i < edges.size(); i++)
     {
-        normal = glm::normalize(normal);
+        // Normalize all the normals
+        normals[i] = glm::normalize(glm::vec2(-edges[i].y, edges[i].x));
     }
 
     return normals;
@@ -378,18 +435,19 @@ std::vector<glm::vec2> Entity::get_normals()
 
 bool Entity::check_collision_SAT(Entity* other)
 {
+    TRACE_ZONE("collision");
     // get the entity corners to project onto the axes
-    std::vector<glm::vec2> self_corners = this->get_corners();
-    std::vector<glm::vec2> other_corners = other->get_corners();
+    std::array<glm::vec2, 4> self_corners = this->get_corners();
+    std::array<glm::vec2, 4> other_corners = other->get_corners();
 
     // get the axes
-    std::vector<glm::vec2> self_normals = this->get_normals();
-    std::vector<glm::vec2> other_normals = other->get_normals();
+    std::array<glm::vec2, 4> self_normals = this->get_normals();
+    std::array<glm::vec2, 4> other_normals = other->get_normals();
 
     // append axes to one list
-    std::vector<glm::vec2> axes;
-    axes.insert(axes.end(), self_normals.begin(), self_normals.end());
-    axes.insert(axes.end(), other_normals.begin(), other_normals.end());
+    std::array<glm::vec2, 8> axes;
+    std::copy(self_normals.begin(), self_normals.end(), axes.begin());
+    std::copy(other_normals.begin(), other_normals.end(), axes.begin() + 4);
 
     // for every axis
     for (auto& axis : axes)
@@ -426,7 +484,7 @@ bool Entity::check_collision_SAT(Entity* other)
 // used by valid collision and update
 std::pair<float, float> Entity::get_min_max_x() 
 {
-    std::vector<glm::vec2> corners = this->get_corners();
+    std::array<glm::vec2, 4> corners = this->get_corners();
     float mini = INFINITY, maxi = -INFINITY;
     for (auto& vertex : corners) {
         mini = glm::min(mini, vertex.x);
@@ -438,7 +496,7 @@ std::pair<float, float> Entity::get_min_max_x()
 
 std::pair<float, float> Entity::get_min_max_y()
 {
-    std::vector<glm::vec2> corners = this->get_corners();
+    std::array<glm::vec2, 4> corners = this->get_corners();
     float mini = INFINITY, maxi = -INFINITY;
     for (auto& vertex : corners) {
         mini = glm::min(mini, vertex.y);
@@ -488,18 +546,14 @@ void Entity::valid_collision(Entity* other) {
 
 
 const void Entity::log_attributes() {
-    std::cout << "Velocity: " << m_velocity.x << " " << m_velocity.y << std::endl;
-    std::cout << "Acceleration: " << m_acceleration.x << " " << m_acceleration.y << std::endl;
-    std::cout << "Position: " << m_position.x << " " << m_position.y << std::endl;
-    std::cout << "Angle: " << m_angle << std::endl;
-    std::cout << std::endl;
+    BINLOG("velocity %.4f %.4f acceleration %.4f %.4f", m_velocity.x, m_velocity.y, m_acceleration.x, m_acceleration.y);
+    BINLOG("position %.4f %.4f angle %.2f fuel %d status %d", m_position.x, m_position.y, m_angle, m_fuel, m_status);
 }
 
 
 const void Entity::log_corners() {
-    std::vector<glm::vec2> corners = get_corners();
+    std::array<glm::vec2, 4> corners = get_corners();
     for (size_t i = 0; i < corners.size(); i++) {
-        std::cout << "Corner: " << i << " x: " << corners[i].x << " y: " << corners[i].y << std::endl;
+        BINLOG("corner %u x %.4f y %.4f", i, corners[i].x, corners[i].y);
     }
-    std::cout << std::endl;
 }
\ No newline at end of file
@@ -4,11 +4,35 @@
 #include "glm/glm.hpp"
 #include "ShaderProgram.h"
 
+#include <array>
 #include <vector>
 
 enum AngleDirection { LEFT, RIGHT, NONE };
 enum EntityStatus { CRASHED, LANDED, ACTIVE, START };
 
+// everything render needs, copied out so another thread can draw it while the
+// entity itself keeps changing
+struct EntitySnapshot
+{
+	glm::vec3 previous_position;
+	glm::vec3 position;
+	glm::vec3 scale;
+	float     previous_angle;
+	float     angle;
+	GLuint    texture_id;
+	int       atlas_index;	// -1 draws the whole texture
+	int       atlas_cols;
+	int       atlas_rows;
+};
+
+// one textured quad with everything worked out, ready to hand to GL
+struct SpriteDraw
+{
+	glm::mat4 model_matrix;
+	GLuint    texture_id;
+	float     tex_coords[12];
+};
+
 class Entity
 {
 private:
@@ -23,6 +47,10 @@ private:
 
 	glm::mat4 m_model_matrix;
 
+	// pose at the start of the current simulation step, for render interpolation
+	glm::vec3 m_previous_position = glm::vec3(0.0f);
+	float     m_previous_angle = 0.0f;
+
 	float	m_speed;
 	float	m_angle; // angle accumulator
 	int		m_fuel;
@@ -52,13 +80,7 @@ private:
 	bool m_enemy;
 
 	// ----- METHODS ----- //
-	std::vector<glm::vec2> get_corners();
-	std::vector<glm::vec2> get_edges();
-	std::vector<glm::vec2> get_normals();
-
 	void valid_collision(Entity* other);
-	std::pair<float, float> get_min_max_x();
-	std::pair<float, float> get_min_max_y();
 
 
 public:
@@ -76,22 +98,39 @@ public:
 	Entity(GLuint texture_id, float speed, glm::vec3 movement, std::vector<std::vector<int>> animations,
 		int animation_frames, int animation_index, int animation_cols, int animation_rows);
 
-	// logs
+	// the ship's state into the binary log, see BinaryLog.h
 	const void log_attributes();
 	const void log_corners();
 
-	void draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint texture_id, int index);
+	static void build_sprite(const EntitySnapshot& snapshot, float alpha, SpriteDraw& sprite);
+	static void draw_sprite(ShaderProgram* program, const SpriteDraw& sprite);
 	void update(float delta_time, Entity* collidable_entities, int collidable_entity_count);
-	void render(ShaderProgram* program);
+	// alpha blends from the previous step's pose (0) to the current one (1)
+	void render(ShaderProgram* program, float alpha = 1.0f);
+	static void render(ShaderProgram* program, const EntitySnapshot& snapshot, float alpha);
+	EntitySnapshot get_snapshot() const;
+	void store_previous_transform();
 	void rotate(float delta_time, AngleDirection dir);
-	void update_fuel(float delta_time, bool using_fuel, std::vector<Entity*>& bubbles, GLuint texture_id);
+	// a fresh bubble as update_fuel() spawns them, the caller owns it
+	static Entity* new_bubble(GLuint texture_id);
+	void update_fuel(float delta_time, bool using_fuel, std::vector<Entity*>& bubbles,
+		std::vector<Entity*>& bubble_pool, GLuint texture_id);
 	void set_animation_state(int num);
+	void reset_animation();
 
 	void set_dimensions(float x, float y);
 
 	// SAT collision cause box collisions are janky
 	bool check_collision_SAT(Entity* other);
 
+	// the geometry behind it, public so the benchmark can time them on their own.
+	// fixed size so collision checks never touch the heap
+	std::array<glm::vec2, 4> get_corners();
+	std::array<glm::vec2, 4> get_edges();
+	std::array<glm::vec2, 4> get_normals();
+	std::pair<float, float> get_min_max_x();
+	std::pair<float, float> get_min_max_y();
+
 
 	// ----- GETTERS ----- //
 	glm::vec3		const	get_position()		const { return m_position; }
@@ -0,0 +1,144 @@
+#include "Frame.h"
+#include "Trace.h"
+
+#include <cstdio>
+
+namespace
+{
+    constexpr int HUD_TEXT_LENGTH = MAX_LINE_GLYPHS;
+    constexpr float FONT_SIZE = 0.25f;
+    constexpr float FONT_SPACING = 0.05f;
+}
+
+void reserve_frame(FrameData& frame)
+{
+    for (int i = 0; i < HUD_LINES; i++) reserve_text(frame.hud[i], MAX_LINE_GLYPHS);
+    for (int i = 0; i < MAX_MESSAGE_LINES; i++) reserve_text(frame.messages[i], MAX_LINE_GLYPHS);
+}
+
+void build_hud(FrameData& frame, const GameSnapshot& snapshot)
+{
+    // fixed buffers instead of std::string so the HUD never allocates
+    char fuel_string[HUD_TEXT_LENGTH];
+    char x_velocity[HUD_TEXT_LENGTH];
+    char y_velocity[HUD_TEXT_LENGTH];
+    char angle_str[HUD_TEXT_LENGTH];
+
+    glm::vec3 curr_velocity = snapshot.velocity;
+    snprintf(fuel_string, HUD_TEXT_LENGTH, "FUEL: %d", snapshot.fuel);
+    snprintf(x_velocity, HUD_TEXT_LENGTH, "X_SPEED %d", int(curr_velocity.x * 100));
+    snprintf(y_velocity, HUD_TEXT_LENGTH, "Y_SPEED: %d", int(curr_velocity.y * 100));
+    snprintf(angle_str, HUD_TEXT_LENGTH, "ANGLE: %d", ((int(snapshot.angle) % 360) + 360) % 360);
+
+    build_text(frame.hud[0], fuel_string, FONT_SIZE, FONT_SPACING, glm::vec3(3.0f, 3.5f, 0.0f));
+    build_text(frame.hud[1], x_velocity, FONT_SIZE, FONT_SPACING, glm::vec3(3.0f, 3.25f, 0.0f));
+    build_text(frame.hud[2], y_velocity, FONT_SIZE, FONT_SPACING, glm::vec3(3.0f, 3.0f, 0.0f));
+    build_text(frame.hud[3], angle_str, FONT_SIZE, FONT_SPACING, glm::vec3(3.0f, 2.75f, 0.0f));
+
+    frame.message_count = 0;
+    // render at start
+    if (snapshot.status == START)
+    {
+        build_text(frame.messages[frame.message_count++], "PRESS SPACE TO BEGIN", FONT_SIZE, FONT_SPACING, glm::vec3(-1.2f, 0.0f, 0.0f));
+    }
+    // render at collsion
+    else if (snapshot.status == CRASHED)
+    {
+        build_text(frame.messages[frame.message_count++], "MISSION FAILED", FONT_SIZE, FONT_SPACING, glm::vec3(-1.2f, 0.0f, 0.0f));
+    }
+    else if (snapshot.status == LANDED)
+    {
+        build_text(frame.messages[frame.message_count++], "MISSION ACCOMPLISHED", FONT_SIZE, FONT_SPACING, glm::vec3(-1.2f, 0.0f, 0.0f));
+    }
+    else if (snapshot.ship.position.y > 5.0f)
+    {
+        build_text(frame.messages[frame.message_count++], "The Sky is the Limit", FONT_SIZE, FONT_SPACING, glm::vec3(-1.2f, -1.0f, 0.0f));
+        build_text(frame.messages[frame.message_count++], "Good Luck Getting Back Down Here", FONT_SIZE, FONT_SPACING, glm::vec3(-2.0f, -1.3f, 0.0f));
+    }
+    else if (snapshot.fuel == 0)
+    {
+        build_text(frame.messages[frame.message_count++], "and you're outta fuel", FONT_SIZE, FONT_SPACING, glm::vec3(-1.5f, -1.0f, 0.0f));
+    }
+}
+
+void build_sprites(FrameData& frame, const GameSnapshot& snapshot, float alpha)
+{
+    // render all of these regardless of game state
+    frame.sprite_count = 0;
+    Entity::build_sprite(snapshot.ship, alpha, frame.sprites[frame.sprite_count++]);
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        Entity::build_sprite(snapshot.platforms[i], alpha, frame.sprites[frame.sprite_count++]);
+    }
+
+    for (int i = snapshot.bubble_count; i > 0; i--) {
+        Entity::build_sprite(snapshot.bubbles[i-1], alpha, frame.sprites[frame.sprite_count++]);
+    }
+}
+
+void build_frame(FrameData& frame, const GameSnapshot& snapshot, float alpha)
+{
+    build_hud(frame, snapshot);
+    build_sprites(frame, snapshot, alpha);
+}
+
+LevelTextures get_level_textures(const GLuint texture_ids[NUM_TEXTURE_ASSETS])
+{
+    LevelTextures textures = { texture_ids[SHIP_TEXTURE], texture_ids[CASTLE_TEXTURE], texture_ids[SHARK_TEXTURE],
+        texture_ids[TOWER_TEXTURE], texture_ids[BUBBLE_TEXTURE] };
+    return textures;
+}
+
+int draw_frame(FrameRenderer& renderer, GLuint font_texture_id, const FrameData& frame)
+{
+    // render text
+    for (int i = 0; i < HUD_LINES; i++)
+    {
+        renderer.draw_text(font_texture_id, frame.hud[i]);
+    }
+
+    // THINGS TO RENDER //
+    for (int i = 0; i < frame.sprite_count; i++)
+    {
+        renderer.draw_sprite(frame.sprites[i]);
+    }
+
+    for (int i = 0; i < frame.message_count; i++)
+    {
+        renderer.draw_text(font_texture_id, frame.messages[i]);
+    }
+    return HUD_LINES + frame.sprite_count + frame.message_count;
+}
+
+// ----- GL ----- //
+void GLFrameRenderer::begin_frame()
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void GLFrameRenderer::draw_sprite(const SpriteDraw& sprite)
+{
+    Entity::draw_sprite(m_shader_program, sprite);
+}
+
+// 4. And render all of them using the pairs
+void GLFrameRenderer::draw_text(GLuint font_texture_id, const TextBatch& batch)
+{
+    TRACE_ZONE("draw_text submit");
+    m_shader_program->set_model_matrix(batch.model_matrix);
+    glUseProgram(m_shader_program->get_program_id());
+
+    glVertexAttribPointer(m_shader_program->get_position_attribute(), 2, GL_FLOAT, false, 0,
+        batch.vertices.data());
+    glEnableVertexAttribArray(m_shader_program->get_position_attribute());
+
+    glVertexAttribPointer(m_shader_program->get_tex_coordinate_attribute(), 2, GL_FLOAT,
+        false, 0, batch.texture_coordinates.data());
+    glEnableVertexAttribArray(m_shader_program->get_tex_coordinate_attribute());
+
+    m_shader_program->bind_texture(font_texture_id);
+    glDrawArrays(GL_TRIANGLES, 0, batch.vertex_count);
+
+    glDisableVertexAttribArray(m_shader_program->get_position_attribute());
+    glDisableVertexAttribArray(m_shader_program->get_tex_coordinate_attribute());
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Entity.h"
+#include "ShaderProgram.h"
+#include "Simulation.h"
+#include "Text.h"
+
+// ----- FRAME ----- //
+// What a frame draws, worked out on the CPU from one GameSnapshot: the HUD,
+// the sprites and whichever message the game state calls for. The game, the
+// replay benchmarks and the golden image checks all build and draw frames
+// through here, so what they time and compare is what the player sees.
+
+constexpr int HUD_LINES = 4;
+constexpr int MAX_MESSAGE_LINES = 2;
+constexpr int MAX_SPRITES = 1 + NUM_PLATFORMS + MAX_BUBBLES;
+constexpr int MAX_LINE_GLYPHS = 32;     // longest HUD or message line
+
+constexpr char SHIP_FILEPATH[] = "assets/bottle_ship_flip.png"; // 208 x 96 13:6
+constexpr char FONTSHEET_FILEPATH[] = "assets/modified_atari_font.png"; // 256 x 256 
+constexpr char PLATFORM1_FILEPATH[] = "assets/castle.png"; // 256 x 128 
+constexpr char SHARK_FILEPATH[] = "assets/shark.png"; // 424 x 160 53: 20
+constexpr char TOWER_FILEPATH[] = "assets/tower.png"; // 96 x 128 3:4
+constexpr char BUBBLE_FILEPATH[] = "assets/bubble2.png"; // 16 x 16
+
+// decoded together at startup, indexed by TextureAsset. The tools that draw
+// frames load the same list
+enum TextureAsset { SHIP_TEXTURE, CASTLE_TEXTURE, SHARK_TEXTURE, TOWER_TEXTURE, FONT_TEXTURE, BUBBLE_TEXTURE, NUM_TEXTURE_ASSETS };
+constexpr const char* TEXTURE_FILEPATHS[NUM_TEXTURE_ASSETS] = {
+    SHIP_FILEPATH, PLATFORM1_FILEPATH, SHARK_FILEPATH, TOWER_FILEPATH, FONTSHEET_FILEPATH, BUBBLE_FILEPATH
+};
+
+// fixed size and reused frame to frame, reserve_frame() it once and rebuilding
+// it never allocates
+struct FrameData
+{
+    TextBatch  hud[HUD_LINES];
+    TextBatch  messages[MAX_MESSAGE_LINES];
+    int        message_count;
+    SpriteDraw sprites[MAX_SPRITES];
+    int        sprite_count;
+};
+
+// grows every text batch to MAX_LINE_GLYPHS, before the first frame
+void reserve_frame(FrameData& frame);
+// the two halves touch different parts of FrameData, so they can run side by side
+void build_hud(FrameData& frame, const GameSnapshot& snapshot);
+void build_sprites(FrameData& frame, const GameSnapshot& snapshot, float alpha);
+void build_frame(FrameData& frame, const GameSnapshot& snapshot, float alpha);
+
+// the ids build_level() wants out of a full set, indexed by TextureAsset
+LevelTextures get_level_textures(const GLuint texture_ids[NUM_TEXTURE_ASSETS]);
+
+// ----- FRAME RENDERER ----- //
+// The handful of calls drawing a frame needs, so the same frame can go to GL
+// or to SoftwareRenderer. Draws between begin_frame() and end_frame() land in
+// the order they're made
+class FrameRenderer
+{
+public:
+    virtual ~FrameRenderer() {}
+
+    virtual void begin_frame() = 0;
+    virtual void draw_sprite(const SpriteDraw& sprite) = 0;
+    virtual void draw_text(GLuint font_texture_id, const TextBatch& batch) = 0;
+    virtual void end_frame() = 0;
+};
+
+// HUD, sprites, then messages on top. Leaves begin_frame() and end_frame() to
+// the caller so it can add its own draws, returns how many draws it made
+int draw_frame(FrameRenderer& renderer, GLuint font_texture_id, const FrameData& frame);
+
+// Straight to GL through the game's shader, GL thread only. Presenting the
+// frame is left to whoever owns the window
+class GLFrameRenderer : public FrameRenderer
+{
+public:
+    explicit GLFrameRenderer(ShaderProgram* shader_program) : m_shader_program(shader_program) {}
+
+    void begin_frame() override;
+    void draw_sprite(const SpriteDraw& sprite) override;
+    void draw_text(GLuint font_texture_id, const TextBatch& batch) override;
+    void end_frame() override {}
+
+private:
+    ShaderProgram* m_shader_program;
+};
@@ -0,0 +1,281 @@
+#define GL_SILENCE_DEPRECATION
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <SDL.h>
+#include "FrameCapture.h"
+#include "Trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WINDOWS
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+namespace
+{
+    // frames between glReadPixels and mapping the buffer, long enough that the
+    // GPU has normally finished the copy and mapping doesn't wait on it
+    constexpr uint64_t READBACK_LAG = 2;
+
+    void make_directory(const char* path)
+    {
+        // already being there is fine, anything else shows up when the first file fails
+#ifdef _WINDOWS
+        _mkdir(path);
+#else
+        mkdir(path, 0755);
+#endif
+    }
+}
+
+bool FrameCapture::start(const char* directory, CaptureFormat format, int width, int height, int pixel_buffer_count,
+    int worker_count)
+{
+    m_directory = directory;
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    make_directory(directory);
+
+    m_has_sync = SDL_GL_ExtensionSupported("GL_ARB_sync");
+    m_has_map_range = SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range");
+
+    // allocated once up front, the storage never gets respecified
+    std::vector<PixelBuffer>(pixel_buffer_count).swap(m_pixel_buffers);
+    size_t size = (size_t)width * height * 4;
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        PixelBuffer& buffer = m_pixel_buffers[i];
+        buffer.fence = nullptr;
+        buffer.state = BUFFER_FREE;
+        buffer.mapped = nullptr;
+        buffer.copied = false;
+        glGenBuffers(1, &buffer.id);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_tasks.assign(m_pixel_buffers.size(), nullptr);
+    m_task_head = 0;
+    m_task_count = 0;
+
+    m_frame = 0;
+    m_captured = 0;
+    m_dropped = 0;
+    m_written = 0;
+    m_failed = 0;
+    m_encode_us = 0;
+
+    m_stopping = false;
+    for (int i = 0; i < worker_count; i++)
+    {
+        m_workers.emplace_back(&FrameCapture::worker, this);
+    }
+    m_running = true;
+    return true;
+}
+
+void FrameCapture::shutdown()
+{
+    if (!m_running) return;
+
+    // whatever has been read back still gets written, waiting on the GPU if it has to
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        if (m_pixel_buffers[i].state == BUFFER_READING) map(m_pixel_buffers[i], true);
+    }
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        PixelBuffer& buffer = m_pixel_buffers[i];
+        while (buffer.state == BUFFER_COPYING && !buffer.copied.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+        if (buffer.state == BUFFER_COPYING) unmap(buffer);
+    }
+
+    // workers finish encoding what they have before they stop
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_task_ready.notify_all();
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+    m_workers.clear();
+
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        if (m_pixel_buffers[i].fence != nullptr) glDeleteSync(m_pixel_buffers[i].fence);
+        glDeleteBuffers(1, &m_pixel_buffers[i].id);
+    }
+    m_pixel_buffers.clear();
+    m_tasks.clear();
+    m_task_count = 0;
+    m_running = false;
+}
+
+float const FrameCapture::get_average_encode_ms() const
+{
+    uint64_t frames = get_written() + get_failed();
+    return frames == 0 ? 0.0f : (float)m_encode_us.load(std::memory_order_relaxed) / frames / 1000.0f;
+}
+
+// ----- WORKERS ----- //
+void FrameCapture::worker()
+{
+    TRACE_THREAD_NAME("frame capture");
+
+    // each worker keeps its own buffers, and the task ring is sized in start(),
+    // so nothing allocates once it's warmed up
+    std::vector<unsigned char> pixels((size_t)m_width * m_height * 4);
+    std::vector<unsigned char> scratch;
+    PngEncoder encoder;
+    char filepath[512];
+
+    while (true)
+    {
+        PixelBuffer* buffer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_task_ready.wait(lock, [this] { return m_stopping || m_task_count > 0; });
+            if (m_task_count == 0) return;
+
+            buffer = m_tasks[m_task_head];
+            m_task_head = (m_task_head + 1) % m_tasks.size();
+            m_task_count--;
+        }
+
+        // out of the mapping as quick as possible so the GL thread can have it
+        // back, swapping BGRA round to RGBA on the way
+        uint64_t frame = buffer->frame;
+        {
+            TRACE_ZONE("copy capture");
+            const unsigned char* source = (const unsigned char*)buffer->mapped;
+            unsigned char* destination = pixels.data();
+            for (size_t i = 0; i < pixels.size(); i += 4)
+            {
+                destination[i] = source[i + 2];
+                destination[i + 1] = source[i + 1];
+                destination[i + 2] = source[i];
+                destination[i + 3] = source[i + 3];
+            }
+        }
+        buffer->copied.store(true, std::memory_order_release);
+
+        TRACE_ZONE("encode capture");
+        auto start = std::chrono::steady_clock::now();
+        bool ok;
+        if (m_format == CAPTURE_PNG)
+        {
+            snprintf(filepath, sizeof(filepath), "%s/frame_%06llu.png", m_directory.c_str(), (unsigned long long)frame);
+            ok = write_png(filepath, pixels.data(), m_width, m_height, true, encoder);
+        }
+        else
+        {
+            snprintf(filepath, sizeof(filepath), "%s/frame_%06llu.ppm", m_directory.c_str(), (unsigned long long)frame);
+            ok = write_ppm(filepath, pixels.data(), m_width, m_height, true, scratch);
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        m_encode_us += (uint64_t)elapsed.count();
+        if (ok) m_written++;
+        else m_failed++;
+    }
+}
+
+// ----- GL THREAD ----- //
+bool FrameCapture::map(PixelBuffer& buffer, bool wait)
+{
+    if (buffer.fence != nullptr)
+    {
+        GLenum status = glClientWaitSync(buffer.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+            wait ? 1000000000ull : 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+
+    size_t size = (size_t)m_width * m_height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+    buffer.mapped = m_has_map_range
+        ? glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT)
+        : glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (buffer.mapped == nullptr)
+    {
+        m_failed++;
+        buffer.state = BUFFER_FREE;
+        return false;
+    }
+
+    buffer.copied.store(false, std::memory_order_relaxed);
+    buffer.state = BUFFER_COPYING;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks[(m_task_head + m_task_count) % m_tasks.size()] = &buffer;
+        m_task_count++;
+    }
+    m_task_ready.notify_one();
+    return true;
+}
+
+void FrameCapture::unmap(PixelBuffer& buffer)
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    buffer.mapped = nullptr;
+    buffer.state = BUFFER_FREE;
+}
+
+void FrameCapture::capture()
+{
+    if (!m_running) return;
+    TRACE_ZONE("capture");
+    m_frame++;
+
+    // hand back buffers the workers are done with, and pass on any that have
+    // had long enough for the copy to finish
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        PixelBuffer& buffer = m_pixel_buffers[i];
+        if (buffer.state == BUFFER_COPYING && buffer.copied.load(std::memory_order_acquire)) unmap(buffer);
+    }
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        PixelBuffer& buffer = m_pixel_buffers[i];
+        if (buffer.state == BUFFER_READING && m_frame - buffer.read_on >= READBACK_LAG) map(buffer, false);
+    }
+
+    PixelBuffer* buffer = nullptr;
+    for (size_t i = 0; i < m_pixel_buffers.size() && buffer == nullptr; i++)
+    {
+        if (m_pixel_buffers[i].state == BUFFER_FREE) buffer = &m_pixel_buffers[i];
+    }
+    if (buffer == nullptr)
+    {
+        m_dropped++;
+        return;
+    }
+
+    // With a pack buffer bound this only queues the copy, the pointer is an
+    // offset. BGRA is what the window is actually stored as on most drivers,
+    // asking for RGBA made llvmpipe convert every pixel right here
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->id);
+    glReadPixels(0, 0, m_width, m_height, GL_BGRA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (m_has_sync) buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    buffer->frame = m_captured++;
+    buffer->read_on = m_frame;
+    buffer->state = BUFFER_READING;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImageWriter.h"
+
+enum CaptureFormat { CAPTURE_PNG, CAPTURE_RAW };
+
+// Records every drawn frame to a numbered image sequence without stalling the
+// frame.
+//
+//   GL thread: glReadPixels into a free pixel buffer object, drop a fence
+//   GL thread: a couple of frames later, once the fence signals, map it
+//   worker:    copy the pixels out of the mapping
+//   GL thread: unmap, the buffer is free again
+//   worker:    encode (PNG, or PPM for raw) and write the file
+//
+// capture() never waits on anything. If the ring is full because the workers
+// can't keep up the frame is dropped and counted instead.
+class FrameCapture
+{
+public:
+    // GL thread. directory is created if it isn't there
+    bool start(const char* directory, CaptureFormat format, int width, int height, int pixel_buffer_count,
+        int worker_count);
+    // GL thread, waits for every frame already read back to be written
+    void shutdown();
+
+    // GL thread, after the frame is drawn and before the swap
+    void capture();
+
+    bool     const is_running()      const { return m_running; }
+    uint64_t const get_captured()    const { return m_captured; }
+    uint64_t const get_dropped()     const { return m_dropped; }
+    uint64_t const get_written()     const { return m_written.load(std::memory_order_relaxed); }
+    uint64_t const get_failed()      const { return m_failed.load(std::memory_order_relaxed); }
+    float    const get_average_encode_ms() const;
+    const char* const get_directory() const { return m_directory.c_str(); }
+
+private:
+    enum BufferState { BUFFER_FREE, BUFFER_READING, BUFFER_COPYING };
+
+    struct PixelBuffer
+    {
+        GLuint            id;
+        GLsync            fence;
+        BufferState       state;        // GL thread only
+        uint64_t          frame;        // number of the frame read into it
+        uint64_t          read_on;      // m_frame when glReadPixels was issued
+        const void*       mapped;
+        std::atomic<bool> copied;       // set by the worker once it's done with the mapping
+    };
+
+    std::string   m_directory;
+    CaptureFormat m_format = CAPTURE_PNG;
+    int           m_width = 0;
+    int           m_height = 0;
+    bool          m_running = false;
+    bool          m_has_sync = false;
+    bool          m_has_map_range = false;
+
+    std::vector<PixelBuffer> m_pixel_buffers;   // sized once, never moves
+    uint64_t                 m_frame = 0;       // capture() calls
+    uint64_t                 m_captured = 0;    // frames read back
+    uint64_t                 m_dropped = 0;
+
+    std::vector<std::thread> m_workers;
+    // ring of buffers waiting for a worker, guarded by m_mutex. A buffer is
+    // only ever in it once, so one slot each means it can't fill up
+    std::vector<PixelBuffer*> m_tasks;
+    size_t                   m_task_head = 0;
+    size_t                   m_task_count = 0;
+    std::mutex               m_mutex;
+    std::condition_variable  m_task_ready;
+    bool                     m_stopping = false;
+
+    std::atomic<uint64_t> m_written{ 0 };
+    std::atomic<uint64_t> m_failed{ 0 };
+    std::atomic<uint64_t> m_encode_us{ 0 };
+
+    void worker();
+    bool map(PixelBuffer& buffer, bool wait);
+    void unmap(PixelBuffer& buffer);
+};
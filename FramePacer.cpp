@@ -0,0 +1,46 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "FramePacer.h"
+
+#include <iostream>
+
+void FramePacer::start(PacingMode mode, int target_fps)
+{
+    m_mode = mode;
+
+    if (m_mode == PACING_VSYNC && SDL_GL_SetSwapInterval(1) != 0)
+    {
+        LOG("No vsync (" << SDL_GetError() << "), sleeping between frames instead");
+        m_mode = PACING_SLEEP;
+    }
+    if (m_mode != PACING_VSYNC) SDL_GL_SetSwapInterval(0);
+
+    if (target_fps <= 0) target_fps = DEFAULT_TARGET_FPS;
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    m_period = frequency / target_fps;
+    m_spin_ticks = (Uint64)(frequency * SPIN_MILLISECONDS / 1000.0f);
+    m_deadline = SDL_GetPerformanceCounter() + m_period;
+}
+
+void FramePacer::wait_for_next_frame()
+{
+    if (m_mode != PACING_SLEEP) return;
+
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // more than a whole frame late, don't try to make it up with a burst of frames
+    if (now > m_deadline + m_period)
+    {
+        m_deadline = now + m_period;
+        return;
+    }
+
+    if (now + m_spin_ticks < m_deadline)
+    {
+        Uint64 sleep_ticks = m_deadline - m_spin_ticks - now;
+        SDL_Delay((Uint32)(sleep_ticks * 1000 / SDL_GetPerformanceFrequency()));
+    }
+    while (SDL_GetPerformanceCounter() < m_deadline) {}
+
+    m_deadline += m_period;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <SDL.h>
+
+enum PacingMode { PACING_VSYNC, PACING_SLEEP, PACING_UNLIMITED };
+
+// Keeps the main loop from spinning flat out. With vsync the buffer swap does
+// the waiting; otherwise wait_for_next_frame() sleeps most of the way to the
+// next deadline and spins the last sliver, since SDL_Delay can oversleep.
+class FramePacer
+{
+private:
+    PacingMode m_mode = PACING_UNLIMITED;
+    Uint64     m_period = 0;        // counter ticks per frame
+    Uint64     m_spin_ticks = 0;    // how close to the deadline we stop sleeping
+    Uint64     m_deadline = 0;
+
+public:
+    static constexpr int   DEFAULT_TARGET_FPS = 60;
+    static constexpr float SPIN_MILLISECONDS = 2.0f;
+
+    // call after the GL context exists, vsync falls back to sleeping if the
+    // driver won't give us a swap interval
+    void start(PacingMode mode, int target_fps);
+    // call once per frame, after the swap
+    void wait_for_next_frame();
+
+    PacingMode const get_mode() const { return m_mode; }
+};
@@ -0,0 +1,135 @@
+#define LOG(argument) std::cout << argument << '\n'
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+
+#include "GLCounter.h"
+
+#include <cstdio>
+#include <iostream>
+
+GLFrameCounts GLCounter::s_frame = {};
+GLFrameCounts GLCounter::s_last_frame = {};
+
+namespace
+{
+    int  g_attribute_bytes[GLCounter::MAX_ATTRIBUTES] = {};
+    bool g_attribute_enabled[GLCounter::MAX_ATTRIBUTES] = {};
+
+    FILE*    g_csv = nullptr;
+    uint64_t g_csv_frame = 0;
+
+    const char* CALL_NAMES[GL_CALL_TYPE_COUNT] = {
+        "draw_arrays", "bind_texture", "use_program", "uniform_matrix", "uniform",
+        "vertex_attrib_pointer", "enable_attrib", "disable_attrib", "texture_upload",
+        "buffer_data", "clear"
+    };
+}
+
+void GLCounter::begin_frame()
+{
+    s_frame = GLFrameCounts();
+}
+
+void GLCounter::end_frame()
+{
+    s_last_frame = s_frame;
+    if (g_csv == nullptr) return;
+
+    fprintf(g_csv, "%llu", (unsigned long long)g_csv_frame++);
+    for (int i = 0; i < GL_CALL_TYPE_COUNT; i++)
+    {
+        fprintf(g_csv, ",%u", s_frame.calls[i]);
+    }
+    fprintf(g_csv, ",%llu,%llu,%llu,%llu,%u\n", (unsigned long long)s_frame.vertex_bytes,
+        (unsigned long long)s_frame.uniform_bytes, (unsigned long long)s_frame.texture_bytes,
+        (unsigned long long)s_frame.buffer_bytes, s_frame.errors);
+}
+
+unsigned GLCounter::state_changes(const GLFrameCounts& counts)
+{
+    unsigned changes = 0;
+    for (int i = 0; i < GL_CALL_TYPE_COUNT; i++)
+    {
+        if (i != GL_CALL_DRAW_ARRAYS && i != GL_CALL_CLEAR) changes += counts.calls[i];
+    }
+    return changes;
+}
+
+uint64_t GLCounter::total_bytes(const GLFrameCounts& counts)
+{
+    return counts.vertex_bytes + counts.uniform_bytes + counts.texture_bytes + counts.buffer_bytes;
+}
+
+const char* GLCounter::get_call_name(GLCallType type)
+{
+    return CALL_NAMES[type];
+}
+
+bool GLCounter::open_csv(const char* filepath)
+{
+    close_csv();
+    g_csv = fopen(filepath, "w");
+    if (g_csv == nullptr) return false;
+
+    fprintf(g_csv, "frame");
+    for (int i = 0; i < GL_CALL_TYPE_COUNT; i++)
+    {
+        fprintf(g_csv, ",%s", CALL_NAMES[i]);
+    }
+    fprintf(g_csv, ",vertex_bytes,uniform_bytes,texture_bytes,buffer_bytes,errors\n");
+    g_csv_frame = 0;
+    return true;
+}
+
+void GLCounter::close_csv()
+{
+    if (g_csv == nullptr) return;
+    fclose(g_csv);
+    g_csv = nullptr;
+}
+
+void GLCounter::set_attribute_bytes(GLuint index, int bytes_per_vertex)
+{
+    if (index < MAX_ATTRIBUTES) g_attribute_bytes[index] = bytes_per_vertex;
+}
+
+void GLCounter::set_attribute_enabled(GLuint index, bool enabled)
+{
+    if (index < MAX_ATTRIBUTES) g_attribute_enabled[index] = enabled;
+}
+
+void GLCounter::count_draw(GLsizei vertex_count)
+{
+    // client side arrays get copied out of our memory on every draw
+    int bytes_per_vertex = 0;
+    for (int i = 0; i < MAX_ATTRIBUTES; i++)
+    {
+        if (g_attribute_enabled[i]) bytes_per_vertex += g_attribute_bytes[i];
+    }
+    s_frame.vertex_bytes += (uint64_t)vertex_count * bytes_per_vertex;
+}
+
+void GLCounter::count_texture(GLenum format, GLsizei width, GLsizei height)
+{
+    int bytes_per_texel = format == GL_RGBA ? 4 : 1;   // RGBA or the packed GL_ALPHA layouts
+    s_frame.texture_bytes += (uint64_t)width * height * bytes_per_texel;
+}
+
+void GLCounter::check_error(const char* call)
+{
+#ifndef NDEBUG
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+    {
+        s_frame.errors++;
+        LOG("GL error 0x" << std::hex << error << std::dec << " after " << call);
+    }
+#else
+    (void)call;
+#endif
+}
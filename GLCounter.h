@@ -0,0 +1,247 @@
+#pragma once
+
+// included from ShaderProgram.h, after the GL headers
+
+#include <cstdint>
+
+// ----- GL CALL COUNTING ----- //
+// Build with COUNT_GL_CALLS defined and the GL entry points the renderer uses
+// get redirected through the counted_ wrappers below, which tally calls by type
+// and the bytes each one hands the driver. Debug builds (no NDEBUG) also check
+// glGetError after every wrapped call. Without the define nothing is wrapped
+// and every count stays at zero.
+//
+// GL only ever happens on the main thread so none of this is thread safe.
+
+enum GLCallType
+{
+    GL_CALL_DRAW_ARRAYS,
+    GL_CALL_BIND_TEXTURE,
+    GL_CALL_USE_PROGRAM,
+    GL_CALL_UNIFORM_MATRIX,
+    GL_CALL_UNIFORM,
+    GL_CALL_VERTEX_ATTRIB_POINTER,
+    GL_CALL_ENABLE_ATTRIB,
+    GL_CALL_DISABLE_ATTRIB,
+    GL_CALL_TEXTURE_UPLOAD,
+    GL_CALL_BUFFER_DATA,
+    GL_CALL_CLEAR,
+    GL_CALL_TYPE_COUNT
+};
+
+struct GLFrameCounts
+{
+    unsigned calls[GL_CALL_TYPE_COUNT];
+    uint64_t vertex_bytes;      // client side arrays copied at draw time
+    uint64_t uniform_bytes;
+    uint64_t texture_bytes;
+    uint64_t buffer_bytes;
+    unsigned errors;
+};
+
+class GLCounter
+{
+public:
+    static constexpr int MAX_ATTRIBUTES = 16;
+
+    static void begin_frame();
+    // finishes the frame's counts, writing them to the CSV if one is open
+    static void end_frame();
+    static GLFrameCounts const& get_last_frame() { return s_last_frame; }
+
+    // everything except draws and clears, i.e. what the driver has to validate
+    static unsigned state_changes(const GLFrameCounts& counts);
+    static uint64_t total_bytes(const GLFrameCounts& counts);
+    static const char* get_call_name(GLCallType type);
+
+    // one row per frame from here on, false if the file couldn't be opened
+    static bool open_csv(const char* filepath);
+    static void close_csv();
+
+    // used by the wrappers
+    static void count(GLCallType type) { s_frame.calls[type]++; }
+    static void set_attribute_bytes(GLuint index, int bytes_per_vertex);
+    static void set_attribute_enabled(GLuint index, bool enabled);
+    static void count_draw(GLsizei vertex_count);
+    static void count_uniform(uint64_t bytes) { s_frame.uniform_bytes += bytes; }
+    static void count_texture(GLenum format, GLsizei width, GLsizei height);
+    static void count_buffer(uint64_t bytes) { s_frame.buffer_bytes += bytes; }
+    static void check_error(const char* call);
+
+private:
+    static GLFrameCounts s_frame;
+    static GLFrameCounts s_last_frame;
+};
+
+#ifdef COUNT_GL_CALLS
+
+// the real entry points, captured before the names get redirected (glew makes
+// some of them macros, so going through these keeps both setups working)
+inline void real_glDrawArrays(GLenum mode, GLint first, GLsizei count) { glDrawArrays(mode, first, count); }
+inline void real_glBindTexture(GLenum target, GLuint texture) { glBindTexture(target, texture); }
+inline void real_glUseProgram(GLuint program) { glUseProgram(program); }
+inline void real_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) { glUniformMatrix4fv(location, count, transpose, value); }
+inline void real_glUniform1i(GLint location, GLint v0) { glUniform1i(location, v0); }
+inline void real_glUniform2f(GLint location, GLfloat v0, GLfloat v1) { glUniform2f(location, v0, v1); }
+inline void real_glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { glUniform4f(location, v0, v1, v2, v3); }
+inline void real_glUniform4fv(GLint location, GLsizei count, const GLfloat* value) { glUniform4fv(location, count, value); }
+inline void real_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) { glVertexAttribPointer(index, size, type, normalized, stride, pointer); }
+inline void real_glEnableVertexAttribArray(GLuint index) { glEnableVertexAttribArray(index); }
+inline void real_glDisableVertexAttribArray(GLuint index) { glDisableVertexAttribArray(index); }
+inline void real_glTexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) { glTexImage2D(target, level, internal_format, width, height, border, format, type, pixels); }
+inline void real_glTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) { glTexSubImage2D(target, level, x, y, width, height, format, type, pixels); }
+inline void real_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) { glBufferData(target, size, data, usage); }
+inline void real_glClear(GLbitfield mask) { glClear(mask); }
+
+inline void counted_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    real_glDrawArrays(mode, first, count);
+    GLCounter::count(GL_CALL_DRAW_ARRAYS);
+    GLCounter::count_draw(count);
+    GLCounter::check_error("glDrawArrays");
+}
+
+inline void counted_glBindTexture(GLenum target, GLuint texture)
+{
+    real_glBindTexture(target, texture);
+    GLCounter::count(GL_CALL_BIND_TEXTURE);
+    GLCounter::check_error("glBindTexture");
+}
+
+inline void counted_glUseProgram(GLuint program)
+{
+    real_glUseProgram(program);
+    GLCounter::count(GL_CALL_USE_PROGRAM);
+    GLCounter::check_error("glUseProgram");
+}
+
+inline void counted_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    real_glUniformMatrix4fv(location, count, transpose, value);
+    GLCounter::count(GL_CALL_UNIFORM_MATRIX);
+    GLCounter::count_uniform((uint64_t)count * 16 * sizeof(GLfloat));
+    GLCounter::check_error("glUniformMatrix4fv");
+}
+
+inline void counted_glUniform1i(GLint location, GLint v0)
+{
+    real_glUniform1i(location, v0);
+    GLCounter::count(GL_CALL_UNIFORM);
+    GLCounter::count_uniform(sizeof(GLint));
+    GLCounter::check_error("glUniform1i");
+}
+
+inline void counted_glUniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+    real_glUniform2f(location, v0, v1);
+    GLCounter::count(GL_CALL_UNIFORM);
+    GLCounter::count_uniform(2 * sizeof(GLfloat));
+    GLCounter::check_error("glUniform2f");
+}
+
+inline void counted_glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+    real_glUniform4f(location, v0, v1, v2, v3);
+    GLCounter::count(GL_CALL_UNIFORM);
+    GLCounter::count_uniform(4 * sizeof(GLfloat));
+    GLCounter::check_error("glUniform4f");
+}
+
+inline void counted_glUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    real_glUniform4fv(location, count, value);
+    GLCounter::count(GL_CALL_UNIFORM);
+    GLCounter::count_uniform((uint64_t)count * 4 * sizeof(GLfloat));
+    GLCounter::check_error("glUniform4fv");
+}
+
+inline void counted_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    real_glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    GLCounter::count(GL_CALL_VERTEX_ATTRIB_POINTER);
+    // every array we hand over is tightly packed floats or bytes
+    int component_bytes = type == GL_FLOAT ? (int)sizeof(GLfloat) : 1;
+    GLCounter::set_attribute_bytes(index, stride != 0 ? stride : size * component_bytes);
+    GLCounter::check_error("glVertexAttribPointer");
+}
+
+inline void counted_glEnableVertexAttribArray(GLuint index)
+{
+    real_glEnableVertexAttribArray(index);
+    GLCounter::count(GL_CALL_ENABLE_ATTRIB);
+    GLCounter::set_attribute_enabled(index, true);
+    GLCounter::check_error("glEnableVertexAttribArray");
+}
+
+inline void counted_glDisableVertexAttribArray(GLuint index)
+{
+    real_glDisableVertexAttribArray(index);
+    GLCounter::count(GL_CALL_DISABLE_ATTRIB);
+    GLCounter::set_attribute_enabled(index, false);
+    GLCounter::check_error("glDisableVertexAttribArray");
+}
+
+inline void counted_glTexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    real_glTexImage2D(target, level, internal_format, width, height, border, format, type, pixels);
+    GLCounter::count(GL_CALL_TEXTURE_UPLOAD);
+    if (pixels != nullptr) GLCounter::count_texture(format, width, height);
+    GLCounter::check_error("glTexImage2D");
+}
+
+inline void counted_glTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+    real_glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+    GLCounter::count(GL_CALL_TEXTURE_UPLOAD);
+    GLCounter::count_texture(format, width, height);
+    GLCounter::check_error("glTexSubImage2D");
+}
+
+inline void counted_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    real_glBufferData(target, size, data, usage);
+    GLCounter::count(GL_CALL_BUFFER_DATA);
+    if (data != nullptr) GLCounter::count_buffer((uint64_t)size);
+    GLCounter::check_error("glBufferData");
+}
+
+inline void counted_glClear(GLbitfield mask)
+{
+    real_glClear(mask);
+    GLCounter::count(GL_CALL_CLEAR);
+    GLCounter::check_error("glClear");
+}
+
+#undef glDrawArrays
+#undef glBindTexture
+#undef glUseProgram
+#undef glUniformMatrix4fv
+#undef glUniform1i
+#undef glUniform2f
+#undef glUniform4f
+#undef glUniform4fv
+#undef glVertexAttribPointer
+#undef glEnableVertexAttribArray
+#undef glDisableVertexAttribArray
+#undef glTexImage2D
+#undef glTexSubImage2D
+#undef glBufferData
+#undef glClear
+
+#define glDrawArrays counted_glDrawArrays
+#define glBindTexture counted_glBindTexture
+#define glUseProgram counted_glUseProgram
+#define glUniformMatrix4fv counted_glUniformMatrix4fv
+#define glUniform1i counted_glUniform1i
+#define glUniform2f counted_glUniform2f
+#define glUniform4f counted_glUniform4f
+#define glUniform4fv counted_glUniform4fv
+#define glVertexAttribPointer counted_glVertexAttribPointer
+#define glEnableVertexAttribArray counted_glEnableVertexAttribArray
+#define glDisableVertexAttribArray counted_glDisableVertexAttribArray
+#define glTexImage2D counted_glTexImage2D
+#define glTexSubImage2D counted_glTexSubImage2D
+#define glBufferData counted_glBufferData
+#define glClear counted_glClear
+
+#endif // COUNT_GL_CALLS
@@ -0,0 +1,316 @@
+#include "ImageWriter.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    constexpr int WINDOW_SIZE = 32768;         // furthest back deflate can point
+    constexpr int HASH_BITS = 15;
+    constexpr int MIN_MATCH = 3;
+    constexpr int MAX_MATCH = 258;
+
+    const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83,
+        99, 115, 131, 163, 195, 227, 258 };
+    const int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const int DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+        12, 12, 13, 13 };
+
+    uint32_t reverse_bits(uint32_t code, int length)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+        return reversed;
+    }
+
+    // everything the encoder looks up, worked out the first time it's needed
+    struct Tables
+    {
+        uint32_t crc[256];
+        uint16_t literal_code[288];             // fixed Huffman, already bit reversed
+        uint8_t  literal_length[288];
+        uint8_t  distance_code[30];
+        uint8_t  length_symbol[MAX_MATCH + 1];  // index into LENGTH_BASE
+        uint8_t  distance_symbol[512];          // see get_distance_symbol()
+
+        Tables()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                crc[i] = c;
+            }
+
+            for (int symbol = 0; symbol < 288; symbol++)
+            {
+                uint32_t code;
+                int length;
+                if (symbol < 144)      { code = 0x30 + symbol;          length = 8; }
+                else if (symbol < 256) { code = 0x190 + symbol - 144;   length = 9; }
+                else if (symbol < 280) { code = symbol - 256;           length = 7; }
+                else                   { code = 0xC0 + symbol - 280;    length = 8; }
+                literal_code[symbol] = (uint16_t)reverse_bits(code, length);
+                literal_length[symbol] = (uint8_t)length;
+            }
+            for (int symbol = 0; symbol < 30; symbol++) distance_code[symbol] = (uint8_t)reverse_bits(symbol, 5);
+
+            for (int symbol = 0; symbol < 29; symbol++)
+            {
+                int end = symbol == 28 ? MAX_MATCH + 1 : LENGTH_BASE[symbol + 1];
+                for (int length = LENGTH_BASE[symbol]; length < end; length++) length_symbol[length] = (uint8_t)symbol;
+            }
+            // the first 256 distances directly, past that in steps of 128
+            for (int symbol = 0; symbol < 30; symbol++)
+            {
+                int end = symbol == 29 ? WINDOW_SIZE + 1 : DISTANCE_BASE[symbol + 1];
+                for (int distance = DISTANCE_BASE[symbol]; distance < end; distance++)
+                {
+                    if (distance <= 256) distance_symbol[distance - 1] = (uint8_t)symbol;
+                    else distance_symbol[256 + ((distance - 1) >> 7)] = (uint8_t)symbol;
+                }
+            }
+        }
+
+        int get_distance_symbol(int distance) const
+        {
+            return distance <= 256 ? distance_symbol[distance - 1] : distance_symbol[256 + ((distance - 1) >> 7)];
+        }
+    };
+
+    const Tables& get_tables()
+    {
+        static const Tables tables;
+        return tables;
+    }
+
+    uint32_t update_crc(uint32_t crc, const unsigned char* data, size_t size)
+    {
+        const uint32_t* table = get_tables().crc;
+        for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+    uint32_t adler32(const unsigned char* data, size_t size)
+    {
+        uint32_t a = 1, b = 0;
+        while (size > 0)
+        {
+            // the most that can be summed before the modulo has to happen
+            size_t block = size < 5552 ? size : 5552;
+            for (size_t i = 0; i < block; i++)
+            {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+            data += block;
+            size -= block;
+        }
+        return (b << 16) | a;
+    }
+
+    void put_u32(std::vector<unsigned char>& out, uint32_t value)
+    {
+        unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16),
+            (unsigned char)(value >> 8), (unsigned char)value };
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    // deflate is least significant bit first
+    struct BitWriter
+    {
+        std::vector<unsigned char>& out;
+        uint64_t bits;
+        int      count;
+
+        void put(uint32_t value, int length)
+        {
+            bits |= (uint64_t)value << count;
+            count += length;
+            while (count >= 8)
+            {
+                out.push_back((unsigned char)bits);
+                bits >>= 8;
+                count -= 8;
+            }
+        }
+
+        void flush()
+        {
+            if (count > 0) out.push_back((unsigned char)bits);
+            bits = 0;
+            count = 0;
+        }
+    };
+
+    void deflate(const unsigned char* data, int size, std::vector<int>& head, std::vector<unsigned char>& out)
+    {
+        const Tables& tables = get_tables();
+
+        // zlib header: deflate, 32K window, fastest
+        out.push_back(0x78);
+        out.push_back(0x01);
+
+        BitWriter writer = { out, 0, 0 };
+        writer.put(1, 1);   // final block
+        writer.put(1, 2);   // fixed Huffman codes
+
+        head.assign((size_t)1 << HASH_BITS, -WINDOW_SIZE - 1);
+        int position = 0;
+        while (position < size)
+        {
+            int best_length = 0;
+            int best_distance = 0;
+            if (position + MIN_MATCH <= size)
+            {
+                uint32_t hash = ((uint32_t)data[position] << 16 | (uint32_t)data[position + 1] << 8 | data[position + 2])
+                    * 2654435761u >> (32 - HASH_BITS);
+                int candidate = head[hash];
+                head[hash] = position;
+
+                int distance = position - candidate;
+                if (distance <= WINDOW_SIZE)
+                {
+                    int limit = size - position < MAX_MATCH ? size - position : MAX_MATCH;
+                    int length = 0;
+                    while (length < limit && data[candidate + length] == data[position + length]) length++;
+                    if (length >= MIN_MATCH)
+                    {
+                        best_length = length;
+                        best_distance = distance;
+                    }
+                }
+            }
+
+            if (best_length == 0)
+            {
+                int symbol = data[position++];
+                writer.put(tables.literal_code[symbol], tables.literal_length[symbol]);
+                continue;
+            }
+
+            int length_symbol = tables.length_symbol[best_length];
+            writer.put(tables.literal_code[257 + length_symbol], tables.literal_length[257 + length_symbol]);
+            writer.put(best_length - LENGTH_BASE[length_symbol], LENGTH_EXTRA[length_symbol]);
+
+            int distance_symbol = tables.get_distance_symbol(best_distance);
+            writer.put(tables.distance_code[distance_symbol], 5);
+            writer.put(best_distance - DISTANCE_BASE[distance_symbol], DISTANCE_EXTRA[distance_symbol]);
+
+            // only the start of a match goes in the hash, skipping the rest is
+            // most of why this is quick
+            position += best_length;
+        }
+
+        writer.put(tables.literal_code[256], tables.literal_length[256]);
+        writer.flush();
+        put_u32(out, adler32(data, size));
+    }
+
+    void add_chunk(std::vector<unsigned char>& png, const char* type, size_t data_start)
+    {
+        // data already appended after a placeholder length and the type
+        size_t length = png.size() - data_start;
+        size_t start = data_start - 8;
+        png[start] = (unsigned char)(length >> 24);
+        png[start + 1] = (unsigned char)(length >> 16);
+        png[start + 2] = (unsigned char)(length >> 8);
+        png[start + 3] = (unsigned char)length;
+        memcpy(&png[start + 4], type, 4);
+        put_u32(png, update_crc(0xFFFFFFFFu, &png[start + 4], length + 4) ^ 0xFFFFFFFFu);
+    }
+
+    void begin_chunk(std::vector<unsigned char>& png)
+    {
+        png.insert(png.end(), 8, 0);
+    }
+
+    bool write_file(const char* filepath, const unsigned char* data, size_t size)
+    {
+        FILE* file = fopen(filepath, "wb");
+        if (file == nullptr) return false;
+
+        bool ok = fwrite(data, 1, size, file) == size;
+        return fclose(file) == 0 && ok;
+    }
+}
+
+const std::vector<unsigned char>& PngEncoder::encode(const unsigned char* rgba, int width, int height, bool bottom_up)
+{
+    // Up filter everywhere but the first row, so a row like the one above it
+    // turns into zeros and long matches
+    size_t row_size = (size_t)width * 3 + 1;
+    m_filtered.resize(row_size * height);
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char* row = rgba + (size_t)(bottom_up ? height - 1 - y : y) * width * 4;
+        const unsigned char* above = y == 0 ? nullptr : rgba + (size_t)(bottom_up ? height - y : y - 1) * width * 4;
+        unsigned char* out = &m_filtered[row_size * y];
+
+        out[0] = above == nullptr ? 0 : 2;
+        for (int x = 0; x < width; x++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                out[1 + x * 3 + c] = above == nullptr ? row[x * 4 + c] : (unsigned char)(row[x * 4 + c] - above[x * 4 + c]);
+            }
+        }
+    }
+
+    static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    m_png.clear();
+    m_png.insert(m_png.end(), SIGNATURE, SIGNATURE + 8);
+
+    // 8 bits a channel, RGB, no interlacing
+    begin_chunk(m_png);
+    size_t start = m_png.size();
+    put_u32(m_png, (uint32_t)width);
+    put_u32(m_png, (uint32_t)height);
+    const unsigned char header[5] = { 8, 2, 0, 0, 0 };
+    m_png.insert(m_png.end(), header, header + 5);
+    add_chunk(m_png, "IHDR", start);
+
+    begin_chunk(m_png);
+    start = m_png.size();
+    deflate(m_filtered.data(), (int)m_filtered.size(), m_head, m_png);
+    add_chunk(m_png, "IDAT", start);
+
+    begin_chunk(m_png);
+    add_chunk(m_png, "IEND", m_png.size());
+    return m_png;
+}
+
+bool write_png(const char* filepath, const unsigned char* rgba, int width, int height, bool bottom_up,
+    PngEncoder& encoder)
+{
+    const std::vector<unsigned char>& png = encoder.encode(rgba, width, height, bottom_up);
+    return write_file(filepath, png.data(), png.size());
+}
+
+bool write_ppm(const char* filepath, const unsigned char* rgba, int width, int height, bool bottom_up,
+    std::vector<unsigned char>& scratch)
+{
+    FILE* file = fopen(filepath, "wb");
+    if (file == nullptr) return false;
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    scratch.resize((size_t)width * 3);
+    bool ok = true;
+    for (int y = 0; y < height && ok; y++)
+    {
+        const unsigned char* row = rgba + (size_t)(bottom_up ? height - 1 - y : y) * width * 4;
+        for (int x = 0; x < width; x++)
+        {
+            scratch[x * 3] = row[x * 4];
+            scratch[x * 3 + 1] = row[x * 4 + 1];
+            scratch[x * 3 + 2] = row[x * 4 + 2];
+        }
+        ok = fwrite(scratch.data(), 1, scratch.size(), file) == scratch.size();
+    }
+    return fclose(file) == 0 && ok;
+}
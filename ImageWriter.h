@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// ----- IMAGE WRITING ----- //
+// PNG and PPM out of RGBA pixels, for frame captures and golden images.
+// Alpha is dropped since nothing drawn to the window means anything by it.
+// Nothing in here touches GL.
+
+// A small PNG encoder built for speed on game frames rather than size: Up
+// filtered rows, then a greedy single probe LZ77 into fixed Huffman codes. Big
+// flat areas of background squash right down, busy frames come out bigger
+// than zlib would make them. Keeps its buffers between images so encoding a
+// stream of same sized frames never allocates.
+class PngEncoder
+{
+public:
+    // bottom_up for rows straight out of glReadPixels. The returned bytes are
+    // the whole file and stay valid until the next encode()
+    const std::vector<unsigned char>& encode(const unsigned char* rgba, int width, int height, bool bottom_up);
+
+private:
+    std::vector<unsigned char> m_filtered;   // filter byte + RGB, a row at a time
+    std::vector<int>           m_head;       // last position each 3 byte hash was seen at
+    std::vector<unsigned char> m_png;
+};
+
+// false if the file couldn't be written
+bool write_png(const char* filepath, const unsigned char* rgba, int width, int height, bool bottom_up,
+    PngEncoder& encoder);
+// binary P6, scratch holds a row and keeps its capacity
+bool write_ppm(const char* filepath, const unsigned char* rgba, int width, int height, bool bottom_up,
+    std::vector<unsigned char>& scratch);
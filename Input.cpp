@@ -0,0 +1,50 @@
+#include "Input.h"
+
+SimInput InputLatch::latch(InputQueue& queue, uint64_t step_end)
+{
+    // a key counts for this step if it was down at any point during it, so a
+    // press and release inside one step still does something
+    bool active[NUM_INPUT_KEYS];
+    for (int i = 0; i < NUM_INPUT_KEYS; i++) active[i] = m_held[i];
+
+    SimInput input = {};
+
+    for (const InputEvent* event = queue.peek(); event != nullptr && event->counter < step_end;
+        event = queue.peek())
+    {
+        if (event->key == KEY_RELEASE_ALL)
+        {
+            for (int i = 0; i < NUM_INPUT_KEYS; i++) m_held[i] = false;
+        }
+        else if (event->pressed)
+        {
+            m_held[event->key] = true;
+            active[event->key] = true;
+
+            switch (event->key)
+            {
+            case KEY_START:       input.commands |= COMMAND_START; break;
+            case KEY_RESTART:     input.commands |= COMMAND_RESET; break;
+            case KEY_ADD_FUEL:    input.fuel_change += FUEL_PER_PRESS; break;
+            case KEY_REMOVE_FUEL: input.fuel_change -= FUEL_PER_PRESS; break;
+            default: break;
+            }
+        }
+        else
+        {
+            m_held[event->key] = false;
+        }
+
+        m_sequence = event->sequence;
+        queue.pop();
+    }
+
+    // left wins if both are down, thrust no longer has to wait for neither
+    if (active[KEY_LEFT]) input.angle_dir = LEFT;
+    else if (active[KEY_RIGHT]) input.angle_dir = RIGHT;
+    else input.angle_dir = NONE;
+    input.using_fuel = active[KEY_THRUST];
+    input.sequence = m_sequence;
+
+    return input;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Simulation.h"
+#include "SpscQueue.h"
+
+// ----- INPUT ----- //
+// Key presses and releases are queued with the time they happened instead of
+// being boiled down to one state per frame. Each simulation step then takes
+// only the events from its own slice of time, so a tap shorter than a frame
+// still lands, and lands on the right step.
+
+enum InputKey
+{
+    KEY_LEFT, KEY_RIGHT, KEY_THRUST,            // held
+    KEY_START, KEY_RESTART, KEY_ADD_FUEL, KEY_REMOVE_FUEL, // one-off
+    KEY_RELEASE_ALL,                            // focus lost, let go of everything
+    NUM_INPUT_KEYS
+};
+
+struct InputEvent
+{
+    uint64_t counter;   // performance counter time it happened
+    unsigned sequence;  // counts up from 1, ends up in GameSnapshot::command_sequence
+    InputKey key;
+    bool     pressed;
+};
+
+constexpr size_t INPUT_QUEUE_CAPACITY = 256;
+typedef SpscQueue<InputEvent, INPUT_QUEUE_CAPACITY> InputQueue;
+
+// Consumer side, lives with whichever thread steps the simulation
+class InputLatch
+{
+private:
+    bool     m_held[NUM_INPUT_KEYS] = {};
+    unsigned m_sequence = 0;
+
+public:
+    static constexpr int FUEL_PER_PRESS = 100;
+
+    // builds the input for the step that ends at step_end, taking every event
+    // from before then. Later events stay queued for the steps they belong to
+    SimInput latch(InputQueue& queue, uint64_t step_end);
+};
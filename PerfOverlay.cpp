@@ -0,0 +1,76 @@
+#include "PerfOverlay.h"
+
+#include <algorithm>
+#include <cstdio>
+
+const float PerfOverlay::BUCKET_EDGES_MS[BUCKET_COUNT] = { 4.0f, 8.0f, 12.0f, 17.0f, 21.0f, 25.0f, 34.0f, 1e9f };
+
+void PerfOverlay::add_sample(const FrameSample& sample)
+{
+    m_latest = sample;
+    m_frame_ms[m_next_sample] = sample.frame_ms;
+    m_next_sample = (m_next_sample + 1) % HISTORY_LENGTH;
+    if (m_sample_count < HISTORY_LENGTH) m_sample_count++;
+}
+
+float PerfOverlay::get_percentile(float percentile)
+{
+    if (m_sample_count == 0) return 0.0f;
+
+    // nearest rank, nth_element on a copy so the ring order stays intact
+    std::copy(m_frame_ms, m_frame_ms + m_sample_count, m_sorted);
+    int rank = (int)(percentile / 100.0f * (m_sample_count - 1) + 0.5f);
+    std::nth_element(m_sorted, m_sorted + rank, m_sorted + m_sample_count);
+    return m_sorted[rank];
+}
+
+int PerfOverlay::build_lines()
+{
+    int line = 0;
+    snprintf(m_lines[line++], LINE_LENGTH, "FRAME %.1f MS", m_latest.frame_ms);
+    snprintf(m_lines[line++], LINE_LENGTH, "P50 %.1f P95 %.1f P99 %.1f",
+        get_percentile(50.0f), get_percentile(95.0f), get_percentile(99.0f));
+    snprintf(m_lines[line++], LINE_LENGTH, "STEPS %d DRAWS %d", m_latest.sim_steps, m_latest.draw_calls);
+    // nothing to show unless the GL calls are being counted
+    if (m_latest.gl_state_changes > 0)
+    {
+        snprintf(m_lines[line++], LINE_LENGTH, "GL STATE %d KB %d", m_latest.gl_state_changes, m_latest.gl_kilobytes);
+    }
+    snprintf(m_lines[line++], LINE_LENGTH, "ENTITIES %d BUBBLES %d", m_latest.entity_count, m_latest.bubble_count);
+    // only while F5 is streaming textures in
+    if (m_latest.uploads_queued > 0)
+    {
+        snprintf(m_lines[line++], LINE_LENGTH, "UPLOADS %d KB %d", m_latest.uploads_queued, m_latest.upload_kilobytes);
+    }
+
+    int counts[BUCKET_COUNT] = {};
+    int biggest = 1;
+    for (int i = 0; i < m_sample_count; i++)
+    {
+        int bucket = 0;
+        while (m_frame_ms[i] > BUCKET_EDGES_MS[bucket]) bucket++;
+        counts[bucket]++;
+        biggest = std::max(biggest, counts[bucket]);
+    }
+
+    // one row per bucket, bar length relative to the fullest one
+    for (int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+    {
+        char bar[BAR_LENGTH + 1];
+        int length = counts[bucket] * BAR_LENGTH / biggest;
+        if (counts[bucket] > 0 && length == 0) length = 1;
+        std::fill(bar, bar + length, '#');
+        bar[length] = '\0';
+
+        if (bucket == BUCKET_COUNT - 1)
+        {
+            snprintf(m_lines[line++], LINE_LENGTH, ">%2.0f %s", BUCKET_EDGES_MS[bucket - 1], bar);
+        }
+        else
+        {
+            snprintf(m_lines[line++], LINE_LENGTH, "<%2.0f %s", BUCKET_EDGES_MS[bucket], bar);
+        }
+    }
+
+    return line;
+}
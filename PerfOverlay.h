@@ -0,0 +1,58 @@
+#pragma once
+
+// ----- PERFORMANCE OVERLAY ----- //
+// The numbers behind the F1 overlay. Everything lives in fixed arrays and the
+// text goes into fixed char buffers, so keeping it running costs a few
+// snprintfs a frame and never allocates. Drawing the lines is left to the
+// caller since that needs the font and GL.
+
+// what one frame looked like
+struct FrameSample
+{
+    float frame_ms;         // since the previous frame was drawn
+    int   sim_steps;        // steps the simulation ran since the previous frame
+    int   draw_calls;       // issued by the previous frame
+    int   gl_state_changes; // previous frame, only with COUNT_GL_CALLS
+    int   gl_kilobytes;     // handed to the driver, same
+    int   entity_count;
+    int   bubble_count;
+    int   uploads_queued;   // textures the uploader hasn't finished
+    int   upload_kilobytes; // mapped in pixel buffers or waiting on a fence
+};
+
+class PerfOverlay
+{
+public:
+    static constexpr int HISTORY_LENGTH = 256;   // frames the percentiles cover
+    static constexpr int BUCKET_COUNT = 8;
+    static constexpr int MAX_LINES = 6 + BUCKET_COUNT;
+    static constexpr int LINE_LENGTH = 48;
+    static constexpr int BAR_LENGTH = 24;        // characters in the longest histogram bar
+
+    void add_sample(const FrameSample& sample);
+
+    // 0 to 100, over the last HISTORY_LENGTH frames
+    float get_percentile(float percentile);
+
+    // formats everything into get_line(); returns the number of lines
+    int build_lines();
+
+    const char* get_line(int line) const { return m_lines[line]; }
+
+    void toggle()                 { m_visible = !m_visible; }
+    bool const is_visible() const { return m_visible; }
+
+private:
+    // upper edge of each bucket, the last one catches everything slower
+    static const float BUCKET_EDGES_MS[BUCKET_COUNT];
+
+    bool        m_visible = false;
+    FrameSample m_latest = {};
+
+    float m_frame_ms[HISTORY_LENGTH] = {};
+    int   m_sample_count = 0;
+    int   m_next_sample = 0;
+    float m_sorted[HISTORY_LENGTH];              // scratch for the percentiles
+
+    char  m_lines[MAX_LINES][LINE_LENGTH];
+};
@@ -0,0 +1,154 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "Replay.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const char* STATUS_NAMES[] = { "CRASHED", "LANDED", "ACTIVE", "START" };
+
+    char get_direction_char(AngleDirection direction)
+    {
+        if (direction == LEFT) return 'L';
+        if (direction == RIGHT) return 'R';
+        return 'N';
+    }
+}
+
+const char* get_status_name(EntityStatus status)
+{
+    return STATUS_NAMES[status];
+}
+
+bool Replay::load(const char* filepath)
+{
+    FILE* file = fopen(filepath, "r");
+    if (file == nullptr)
+    {
+        LOG("ERROR: could not open replay " << filepath);
+        return false;
+    }
+
+    entries.clear();
+    hz = 60;
+    step_count = 0;
+    has_expected_status = false;
+
+    char line[256];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != nullptr)
+    {
+        line_number++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+
+        unsigned long long step;
+        char direction, status[16];
+        int thrust, fuel_change;
+        unsigned commands;
+
+        if (sscanf(line, "hz %d", &hz) == 1)
+        {
+            ok = hz > 0;
+        }
+        else if (sscanf(line, "end %llu", &step) == 1)
+        {
+            step_count = step;
+        }
+        else if (sscanf(line, "expect %15s", status) == 1)
+        {
+            has_expected_status = false;
+            for (int i = 0; i < 4; i++)
+            {
+                if (strcmp(status, STATUS_NAMES[i]) == 0)
+                {
+                    expected_status = (EntityStatus)i;
+                    has_expected_status = true;
+                }
+            }
+            ok = has_expected_status;
+        }
+        else if (sscanf(line, "%llu %c %d %u %d", &step, &direction, &thrust, &commands, &fuel_change) == 5)
+        {
+            ReplayEntry entry = {};
+            entry.step = step;
+            entry.input.angle_dir = direction == 'L' ? LEFT : direction == 'R' ? RIGHT : NONE;
+            entry.input.using_fuel = thrust != 0;
+            entry.input.commands = commands;
+            entry.input.fuel_change = fuel_change;
+
+            // steps have to go forwards for get_input() to find them
+            ok = entries.empty() || entries.back().step < entry.step;
+            entries.push_back(entry);
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    fclose(file);
+
+    if (!ok)
+    {
+        LOG("ERROR: " << filepath << ":" << line_number << " is not a valid replay line");
+        return false;
+    }
+
+    // no end line, stop after the last input
+    if (step_count == 0 && !entries.empty()) step_count = entries.back().step + 1;
+    return true;
+}
+
+SimInput Replay::get_input(uint64_t step, size_t& cursor) const
+{
+    while (cursor + 1 < entries.size() && entries[cursor + 1].step <= step) cursor++;
+
+    SimInput input = {};
+    input.angle_dir = NONE;
+    if (entries.empty() || entries[cursor].step > step) return input;
+
+    // held keys carry on, one-offs only on the step they were recorded on
+    const ReplayEntry& entry = entries[cursor];
+    input.angle_dir = entry.input.angle_dir;
+    input.using_fuel = entry.input.using_fuel;
+    if (entry.step == step)
+    {
+        input.commands = entry.input.commands;
+        input.fuel_change = entry.input.fuel_change;
+    }
+    return input;
+}
+
+bool ReplayRecorder::open(const char* filepath, int hz)
+{
+    m_file = fopen(filepath, "w");
+    if (m_file == nullptr) return false;
+
+    fprintf(m_file, "# step direction thrust commands fuel_change\nhz %d\n", hz);
+    m_first = true;
+    return true;
+}
+
+void ReplayRecorder::record(uint64_t step, const SimInput& input)
+{
+    if (m_file == nullptr) return;
+
+    bool changed = m_first || input.angle_dir != m_last.angle_dir || input.using_fuel != m_last.using_fuel;
+    if (!changed && input.commands == 0 && input.fuel_change == 0) return;
+
+    fprintf(m_file, "%llu %c %d %u %d\n", (unsigned long long)step, get_direction_char(input.angle_dir),
+        input.using_fuel ? 1 : 0, input.commands, input.fuel_change);
+    m_last = input;
+    m_first = false;
+}
+
+void ReplayRecorder::close(uint64_t step_count, EntityStatus final_status)
+{
+    if (m_file == nullptr) return;
+
+    fprintf(m_file, "end %llu\nexpect %s\n", (unsigned long long)step_count, get_status_name(final_status));
+    fclose(m_file);
+    m_file = nullptr;
+}
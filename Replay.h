@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Simulation.h"
+
+// ----- REPLAYS ----- //
+// A run recorded as the SimInput each step got, so it plays back exactly
+// without SDL, a window or real time. The file is plain text so reference runs
+// can be tweaked by hand:
+//
+//     # comment
+//     hz 60
+//     <step> <L|R|N> <thrust 0|1> <commands> <fuel_change>
+//     ...
+//     end <step count>
+//     expect <START|ACTIVE|LANDED|CRASHED>
+//
+// A line is only written when the input changes. Turning and thrust hold
+// until the next line, commands and fuel changes only happen on their own
+// step. The expect line is optional and is how the ship finished the recording.
+
+struct ReplayEntry
+{
+    uint64_t step;
+    SimInput input;
+};
+
+struct Replay
+{
+    int      hz = 60;
+    uint64_t step_count = 0;
+    bool     has_expected_status = false;
+    EntityStatus expected_status = START;
+    std::vector<ReplayEntry> entries;
+
+    // false (and a logged reason) if the file is missing or malformed
+    bool load(const char* filepath);
+
+    // input for the given step, steps must be asked for in order. cursor starts
+    // at 0 and remembers where the last call got to
+    SimInput get_input(uint64_t step, size_t& cursor) const;
+};
+
+// Writes a replay as the game runs. Lives with whichever thread steps the
+// simulation, and only touches the file when the input changes
+class ReplayRecorder
+{
+private:
+    FILE*    m_file = nullptr;
+    SimInput m_last = {};
+    bool     m_first = true;
+
+public:
+    bool open(const char* filepath, int hz);
+    void record(uint64_t step, const SimInput& input);
+    void close(uint64_t step_count, EntityStatus final_status);
+    bool const is_open() const { return m_file != nullptr; }
+};
+
+const char* get_status_name(EntityStatus status);
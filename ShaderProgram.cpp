@@ -27,6 +27,9 @@ void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_sh
     m_projection_matrix_uniform = glGetUniformLocation(m_program_id, "projectionMatrix");
     m_view_matrix_uniform       = glGetUniformLocation(m_program_id, "viewMatrix");
     m_colour_uniform            = glGetUniformLocation(m_program_id, "color");
+    m_texture_format_uniform    = glGetUniformLocation(m_program_id, "textureFormat");
+    m_texture_size_uniform      = glGetUniformLocation(m_program_id, "textureSize");
+    m_palette_uniform           = glGetUniformLocation(m_program_id, "palette");
     
     m_position_attribute  = glGetAttribLocation(m_program_id, "position");
     m_tex_coord_attribute = glGetAttribLocation(m_program_id, "texCoord");
@@ -94,6 +97,50 @@ void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
     glUniform4f(m_colour_uniform, red, green, blue, alpha);
 }
 
+void ShaderProgram::register_texture(GLuint texture_id, const TextureLayout& texture)
+{
+    if (m_texture_formats.size() <= texture_id)
+    {
+        m_texture_formats.resize(texture_id + 1, TextureFormatInfo{ TEXTURE_RGBA8 });
+    }
+
+    TextureFormatInfo& info = m_texture_formats[texture_id];
+    info.format = texture.format;
+    info.width = (float)texture.width;
+    info.height = (float)texture.height;
+    info.palette_size = texture.palette_size;
+    for (int i = 0; i < texture.palette_size * 4; i++)
+    {
+        info.palette[i] = texture.palette[i / 4][i % 4] / 255.0f;
+    }
+}
+
+void ShaderProgram::replace_texture(GLuint texture_id, GLuint replacement)
+{
+    if (m_texture_replacements.size() <= texture_id) m_texture_replacements.resize(texture_id + 1, 0);
+    m_texture_replacements[texture_id] = replacement;
+}
+
+void ShaderProgram::bind_texture(GLuint texture_id)
+{
+    if (texture_id < m_texture_replacements.size() && m_texture_replacements[texture_id] != 0)
+    {
+        texture_id = m_texture_replacements[texture_id];
+    }
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+
+    if (texture_id >= m_texture_formats.size() || m_texture_formats[texture_id].format == TEXTURE_RGBA8)
+    {
+        glUniform1i(m_texture_format_uniform, TEXTURE_RGBA8);
+        return;
+    }
+
+    const TextureFormatInfo& info = m_texture_formats[texture_id];
+    glUniform1i(m_texture_format_uniform, info.format);
+    glUniform2f(m_texture_size_uniform, info.width, info.height);
+    glUniform4fv(m_palette_uniform, info.palette_size, info.palette);
+}
+
 void ShaderProgram::set_view_matrix(const glm::mat4 &matrix)
 {
     glUseProgram(m_program_id);
@@ -9,7 +9,20 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
 #include "glm/mat4x4.hpp"
+#include "TextureEncoding.h"
+#include "GLCounter.h"
+
+// what the fragment shader needs to know to expand a low colour texture
+struct TextureFormatInfo
+{
+    TextureFormat format;
+    float         width;
+    float         height;
+    int           palette_size;
+    float         palette[MAX_PALETTE_COLOURS * 4];
+};
 
 class ShaderProgram
 {
@@ -25,12 +38,20 @@ private:
     GLuint m_model_matrix_uniform;
     GLuint m_view_matrix_uniform;
     GLuint m_colour_uniform;
+    GLuint m_texture_format_uniform;
+    GLuint m_texture_size_uniform;
+    GLuint m_palette_uniform;
 
     GLuint m_position_attribute;
     GLuint m_tex_coord_attribute;
 
     GLuint m_vertex_shader;
     GLuint m_fragment_shader;
+
+    // indexed by texture id, anything not registered is plain RGBA
+    std::vector<TextureFormatInfo> m_texture_formats;
+    // indexed by texture id, what gets bound in its place (0 for itself)
+    std::vector<GLuint> m_texture_replacements;
     
 public:
 
@@ -40,6 +61,15 @@ public:
     void set_projection_matrix(const glm::mat4 &matrix);
     void set_view_matrix(const glm::mat4 &matrix);
     void set_colour(float red, float green, float blue, float alpha);
+
+    // remember how a texture is stored so bind_texture can set up the shader
+    void register_texture(GLuint texture_id, const TextureLayout& texture);
+    // glBindTexture plus the format uniforms, use this instead of binding directly.
+    // The uniforms go to the program in use, so set the model matrix first
+    void bind_texture(GLuint texture_id);
+    // from now on binding texture_id binds replacement instead, so a reloaded
+    // texture shows up without touching every entity that holds the old id
+    void replace_texture(GLuint texture_id, GLuint replacement);
     
     GLuint const get_program_id()               const { return m_program_id;          };
     GLuint const get_position_attribute()       const { return m_position_attribute;  };
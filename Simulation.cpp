@@ -0,0 +1,249 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "Simulation.h"
+#include "Trace.h"
+
+#include <chrono>
+#include <iostream>
+
+// the level as the game starts. Allocates the ship and platforms, free_game_state() hands them back
+void build_level(GameState& state, InitialState& initial, const LevelTextures& textures)
+{
+    // ----- SHIP ----- //
+    state.ship = new Entity(
+        textures.ship,                      // texture_id
+        0.0f,                               // speed
+        glm::vec3(0.0f, 0.0f, 0.0f),        // acceleration vector
+        true,                               // use acceleration
+        START,                              // EntityStatus
+        false                               // not enemy
+    );
+
+    state.ship->set_movement(glm::vec3(0.0f, 0.0f, 0.0f));
+    state.ship->set_scale(glm::vec3(1.0833f, 0.5f, 1.0f));
+    state.ship->set_position(glm::vec3(-4.4f, 3.5f, 1.0f));
+    state.ship->set_dimensions(state.ship->get_scale().x, state.ship->get_scale().y);
+    state.ship->update(0.0f, nullptr, 0);
+
+    // the pool starts full so a level's first bubbles don't allocate either
+    state.bubbles.reserve(MAX_BUBBLES);
+    state.bubble_pool.reserve(MAX_BUBBLES);
+    state.bubble_texture_id = textures.bubble;
+    for (int i = 0; i < MAX_BUBBLES; i++)
+    {
+        state.bubble_pool.push_back(Entity::new_bubble(textures.bubble));
+    }
+
+
+    // ----- PLATFORMS ----- //
+    state.platforms = new Entity[NUM_PLATFORMS];
+
+    // castle
+    state.platforms[0] = Entity(
+        textures.castle,                    // texture id
+        0.0f,                               // speed
+        glm::vec3(0.0f),                    // acceleration
+        false,                              // uses acceleration
+        ACTIVE,                             // EntityStatus
+        false                               // landable platform so not enemy
+    );
+    state.platforms[0].set_position(glm::vec3(3.9f, -3.20f, 1.0f));
+    state.platforms[0].set_scale(glm::vec3(2.0f, 1.0f, 1.0f));
+
+    // shark
+    state.platforms[1] = Entity(
+        textures.shark,                     // texture id
+        1.0f,                               // speed
+        glm::vec3(0.0f),                    // acceleration
+        false,                              // uses acceleration
+        ACTIVE,                             // EntityStatus
+        true                                // shark so is enemy 
+    );
+    state.platforms[1].set_position(glm::vec3(0.0f, 0.0f, 1.0f));
+    state.platforms[1].set_scale(glm::vec3(2.65f, 1.0f, 1.0f));
+    state.platforms[1].set_movement(glm::vec3(-0.5f, 0.0f, 0.0f));
+
+    // tower
+    state.platforms[2] = Entity(
+        textures.tower,                     // texture id
+        0.0f,                               // speed
+        glm::vec3(0.0f),                    // acceleration
+        false,                              // uses acceleration
+        ACTIVE,                             // EntityStatus
+        false                               // landable platform so not enemy
+    );
+    state.platforms[2].set_position(glm::vec3(1.0f, -3.2f, 1.0f));
+    state.platforms[2].set_scale(glm::vec3(0.75f, 1.0f, 1.0f));
+
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        state.platforms[i].update(0.0f, nullptr, 0);
+        state.platforms[i].set_dimensions(state.platforms[i].get_scale().x, state.platforms[i].get_scale().y);
+    }
+
+    // nothing to blend from yet
+    state.ship->store_previous_transform();
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        state.platforms[i].store_previous_transform();
+    }
+
+    // ----- SNAPSHOT ----- //
+    initial.ship = *state.ship;
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        initial.platforms[i] = state.platforms[i];
+    }
+}
+
+void apply_commands(GameState& state, const InitialState& initial, const SimInput& input)
+{
+    if (input.commands & COMMAND_RESET) reset_game(state, initial);
+
+    if ((input.commands & COMMAND_START) && state.ship->get_status() == START)
+    {
+        state.ship->set_status(ACTIVE);
+    }
+
+    if (input.fuel_change != 0)
+    {
+        state.ship->set_fuel(state.ship->get_fuel() + input.fuel_change);
+    }
+}
+
+// one fixed timestep of the game
+void step_simulation(GameState& state, const SimInput& input, float delta_time)
+{
+    step_platforms(state, delta_time);
+    step_bubbles(state, delta_time);
+    step_ship(state, input, delta_time);
+}
+
+void step_platforms(GameState& state, float delta_time)
+{
+    // where everything was before this step, render() blends from here
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        state.platforms[i].store_previous_transform();
+    }
+
+    // only update the game if the ship is moving
+    if (state.ship->get_status() != ACTIVE) return;
+
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        state.platforms[i].update(delta_time, nullptr, 0);
+    }
+}
+
+void step_bubbles(GameState& state, float delta_time)
+{
+    TRACE_ZONE("particles");
+    for (size_t i = 0; i < state.bubbles.size(); i++)
+    {
+        state.bubbles[i]->store_previous_transform();
+    }
+
+    if (state.ship->get_status() != ACTIVE) return;
+
+    update_bubbles(state.bubbles, state.bubble_pool, delta_time);
+}
+
+void step_ship(GameState& state, const SimInput& input, float delta_time)
+{
+    state.ship->store_previous_transform();
+
+    if (state.ship->get_status() != ACTIVE) return;
+
+    update_lander(*state.ship, input, state.platforms, NUM_PLATFORMS, state.bubbles,
+        state.bubble_pool, state.bubble_texture_id, delta_time);
+}
+
+void update_bubbles(std::vector<Entity*>& bubbles, std::vector<Entity*>& bubble_pool, float delta_time)
+{
+    for (size_t i = bubbles.size(); i > 0; i--) {
+        size_t index = i - 1;
+        if (bubbles[index]->get_index() == 7) {
+            // hand it back to the pool so the next spawn does not allocate
+            bubble_pool.push_back(bubbles[index]);
+            bubbles.erase(bubbles.begin() + index);  // Remove from vector
+        }
+        else {
+            bubbles[index]->update(delta_time, nullptr, 0);
+        }
+
+    }
+}
+
+void update_lander(Entity& ship, const SimInput& input, Entity* platforms, int platform_count,
+    std::vector<Entity*>& bubbles, std::vector<Entity*>& bubble_pool, GLuint bubble_texture_id, float delta_time)
+{
+    // update angle first
+    if (input.angle_dir != NONE) {
+        ship.rotate(delta_time, input.angle_dir);
+    }
+
+    ship.update_fuel(delta_time, input.using_fuel, bubbles, bubble_pool, bubble_texture_id);
+    ship.update(delta_time, platforms, platform_count);
+}
+
+// puts the simulation back to how initialise() left it, everything GL stays as is
+void reset_game(GameState& state, const InitialState& initial)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    *state.ship = initial.ship;
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        state.platforms[i] = initial.platforms[i];
+    }
+
+    // every live bubble goes back to the pool for the next run
+    for (size_t i = 0; i < state.bubbles.size(); i++)
+    {
+        state.bubble_pool.push_back(state.bubbles[i]);
+    }
+    state.bubbles.clear();
+
+    std::chrono::duration<float, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    LOG("Restarted in " << (int)elapsed.count() << " us");
+}
+
+void take_snapshot(const GameState& state, GameSnapshot& snapshot)
+{
+    snapshot.ship = state.ship->get_snapshot();
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        snapshot.platforms[i] = state.platforms[i].get_snapshot();
+    }
+
+    // anything past MAX_BUBBLES still simulates, it just doesn't get drawn
+    snapshot.bubble_count = 0;
+    for (size_t i = 0; i < state.bubbles.size() && snapshot.bubble_count < MAX_BUBBLES; i++)
+    {
+        snapshot.bubbles[snapshot.bubble_count++] = state.bubbles[i]->get_snapshot();
+    }
+
+    snapshot.status = state.ship->get_status();
+    snapshot.fuel = state.ship->get_fuel();
+    snapshot.velocity = state.ship->get_velocity();
+    snapshot.angle = state.ship->get_angle();
+}
+
+void free_game_state(GameState& state)
+{
+    // delete pointers
+    for (size_t i = state.bubbles.size(); i > 0; i--) {
+        delete state.bubbles[i - 1];
+    }
+    for (size_t i = state.bubble_pool.size(); i > 0; i--) {
+        delete state.bubble_pool[i - 1];
+    }
+    state.bubbles.clear();
+    state.bubble_pool.clear();
+
+    delete state.ship;
+    delete[] state.platforms;
+    state.ship = nullptr;
+    state.platforms = nullptr;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Entity.h"
+
+// ----- SIMULATION ----- //
+// The game logic for one fixed step, pulled out of main.cpp so it can run on
+// its own thread. Nothing in here touches GL; render only ever sees the
+// GameSnapshot that take_snapshot() copies out after a step.
+
+constexpr int NUM_PLATFORMS = 3;
+constexpr int MAX_BUBBLES = 64; // reserved up front so spawning does not grow the vectors
+
+struct GameState
+{
+    Entity* ship;
+    Entity* platforms;
+    std::vector<Entity*> bubbles;
+    std::vector<Entity*> bubble_pool; // popped bubbles waiting to be respawned
+    GLuint bubble_texture_id;
+};
+
+// freshly built level, copied back over the live entities on restart so 'r'
+// never has to touch the window, GL context, shaders or textures again
+struct InitialState
+{
+    Entity ship;
+    Entity platforms[NUM_PLATFORMS];
+};
+
+// key presses that happen once rather than being held
+enum GameCommand { COMMAND_START = 1, COMMAND_RESET = 2 };
+
+// what the player is doing, as seen by a single step
+struct SimInput
+{
+    AngleDirection angle_dir;
+    bool           using_fuel;
+    unsigned       commands;        // GameCommand bits
+    int            fuel_change;
+    unsigned       sequence;        // bumped with every command so render knows when it has landed
+};
+
+// everything render needs from one step, fixed size so publishing never allocates
+struct GameSnapshot
+{
+    EntitySnapshot ship;
+    EntitySnapshot platforms[NUM_PLATFORMS];
+    EntitySnapshot bubbles[MAX_BUBBLES];
+    int            bubble_count;
+
+    EntityStatus   status;
+    int            fuel;
+    glm::vec3      velocity;
+    float          angle;
+
+    unsigned       command_sequence; // last SimInput::sequence applied
+    uint64_t       step_total;       // steps run so far
+    uint64_t       step_counter;     // performance counter time this step stands for
+};
+
+// texture ids for build_level(), left at 0 when nothing is going to be drawn
+struct LevelTextures
+{
+    GLuint ship;
+    GLuint castle;
+    GLuint shark;
+    GLuint tower;
+    GLuint bubble;
+};
+
+// the ship and platforms as the game starts, also copied into initial for restarts
+void build_level(GameState& state, InitialState& initial, const LevelTextures& textures);
+
+// one-off commands, run before the step that picked them up
+void apply_commands(GameState& state, const InitialState& initial, const SimInput& input);
+void step_simulation(GameState& state, const SimInput& input, float delta_time);
+
+// the parts of step_simulation(). Platforms and bubbles never touch each other
+// so they can run at the same time; the ship collides with the platforms and
+// spawns bubbles so it has to wait for both
+void step_platforms(GameState& state, float delta_time);
+void step_bubbles(GameState& state, float delta_time);
+void step_ship(GameState& state, const SimInput& input, float delta_time);
+
+// what those do once they've decided things are moving, over any number of
+// entities. The game only ever has one ship and NUM_PLATFORMS platforms,
+// tools/stress.cpp uses these with as many as it likes
+void update_bubbles(std::vector<Entity*>& bubbles, std::vector<Entity*>& bubble_pool, float delta_time);
+void update_lander(Entity& ship, const SimInput& input, Entity* platforms, int platform_count,
+    std::vector<Entity*>& bubbles, std::vector<Entity*>& bubble_pool, GLuint bubble_texture_id, float delta_time);
+
+void reset_game(GameState& state, const InitialState& initial);
+void take_snapshot(const GameState& state, GameSnapshot& snapshot);
+void free_game_state(GameState& state);
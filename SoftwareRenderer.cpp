@@ -0,0 +1,560 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "SoftwareRenderer.h"
+#include "AssetLoader.h"
+#include "ImageWriter.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SOFTWARE_SSE2 1
+#endif
+
+namespace
+{
+    // the two triangles of the quad Entity::draw_sprite() draws
+    const float SPRITE_VERTICES[] =
+    {
+        -0.5f, -0.5f, 0.5f, -0.5f,  0.5f, 0.5f,
+        -0.5f, -0.5f, 0.5f,  0.5f, -0.5f, 0.5f
+    };
+
+    // pixels are R, G, B, A bytes in memory, so on little endian R is the low byte
+    uint32_t pack_colour(const unsigned char* rgba)
+    {
+        return (uint32_t)rgba[0] | ((uint32_t)rgba[1] << 8) | ((uint32_t)rgba[2] << 16) | ((uint32_t)rgba[3] << 24);
+    }
+
+    double ms_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // x / 255 for 0 <= x < 65536 - 255, without the divide. The SSE2 path does
+    // the same sums so both give identical pixels
+    inline uint32_t divide_255(uint32_t x)
+    {
+        return (x + 1 + (x >> 8)) >> 8;
+    }
+
+    // SRC_ALPHA, ONE_MINUS_SRC_ALPHA on all four channels, like glBlendFunc
+    inline uint32_t blend(uint32_t source, uint32_t destination)
+    {
+        uint32_t alpha = source >> 24;
+        if (alpha == 255) return source;
+        if (alpha == 0) return destination;
+
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t s = (source >> shift) & 0xFF;
+            uint32_t d = (destination >> shift) & 0xFF;
+            result |= divide_255(s * alpha + d * (255 - alpha) + 127) << shift;
+        }
+        return result;
+    }
+
+    inline int wrap(int coordinate, int size)
+    {
+        coordinate %= size;
+        return coordinate < 0 ? coordinate + size : coordinate;
+    }
+
+    // u and v already scaled up to texels. GL_REPEAT either way
+    inline uint32_t sample(const uint32_t* texels, int width, int height, FilterType filter_type, float u, float v)
+    {
+        if (filter_type == NEAREST)
+        {
+            int x = wrap((int)floorf(u), width);
+            int y = wrap((int)floorf(v), height);
+            return texels[y * width + x];
+        }
+
+        // LINEAR, weights in 1/256ths
+        float fu = u - 0.5f, fv = v - 0.5f;
+        float x0 = floorf(fu), y0 = floorf(fv);
+        uint32_t wx = (uint32_t)((fu - x0) * 256.0f);
+        uint32_t wy = (uint32_t)((fv - y0) * 256.0f);
+        int left = wrap((int)x0, width), right = wrap((int)x0 + 1, width);
+        int top = wrap((int)y0, height), bottom = wrap((int)y0 + 1, height);
+
+        uint32_t c00 = texels[top * width + left], c10 = texels[top * width + right];
+        uint32_t c01 = texels[bottom * width + left], c11 = texels[bottom * width + right];
+
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t upper = ((c00 >> shift) & 0xFF) * (256 - wx) + ((c10 >> shift) & 0xFF) * wx;
+            uint32_t lower = ((c01 >> shift) & 0xFF) * (256 - wx) + ((c11 >> shift) & 0xFF) * wx;
+            result |= ((upper * (256 - wy) + lower * wy + 32768) >> 16) << shift;
+        }
+        return result;
+    }
+
+#ifdef SOFTWARE_SSE2
+    // blend() for four pixels at once, 16-bit lanes hold one channel each
+    inline void blend_4(const uint32_t* source, uint32_t* destination)
+    {
+        __m128i src = _mm_loadu_si128((const __m128i*)source);
+        __m128i alpha = _mm_srli_epi32(src, 24);
+        __m128i zero = _mm_setzero_si128();
+
+        // ASCII art, most texels are fully clear or fully solid
+        int clear = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero));
+        if (clear == 0xFFFF) return;
+        int solid = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_set1_epi32(255)));
+        if (solid == 0xFFFF)
+        {
+            _mm_storeu_si128((__m128i*)destination, src);
+            return;
+        }
+
+        __m128i dst = _mm_loadu_si128((const __m128i*)destination);
+        __m128i max = _mm_set1_epi16(255);
+        __m128i round = _mm_set1_epi16(127);
+        __m128i one = _mm_set1_epi16(1);
+
+        __m128i halves[2];
+        for (int half = 0; half < 2; half++)
+        {
+            __m128i s = half == 0 ? _mm_unpacklo_epi8(src, zero) : _mm_unpackhi_epi8(src, zero);
+            __m128i d = half == 0 ? _mm_unpacklo_epi8(dst, zero) : _mm_unpackhi_epi8(dst, zero);
+            __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+            __m128i x = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, _mm_sub_epi16(max, a))), round);
+            halves[half] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8);
+        }
+        _mm_storeu_si128((__m128i*)destination, _mm_packus_epi16(halves[0], halves[1]));
+    }
+#endif
+
+    void fill(uint32_t* pixels, int count, uint32_t colour)
+    {
+        int i = 0;
+#ifdef SOFTWARE_SSE2
+        __m128i value = _mm_set1_epi32((int)colour);
+        for (; i + 4 <= count; i += 4) _mm_storeu_si128((__m128i*)(pixels + i), value);
+#endif
+        for (; i < count; i++) pixels[i] = colour;
+    }
+}
+
+void SoftwareRenderer::start(int width, int height, int worker_count)
+{
+    m_width = width;
+    m_height = height;
+    m_tiles_x = (width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    m_tiles_y = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    m_pixels.assign((size_t)width * height, m_clear_colour);
+
+    // one bin task per thread, and a few raster tasks each so a busy tile
+    // doesn't leave the others waiting
+    int thread_count = worker_count + 1;
+    m_bin_tasks.resize(thread_count);
+    m_raster_tasks.resize(std::min(thread_count * 4, m_tiles_x * m_tiles_y));
+
+    // the graph keeps pointers to these, so they are sized before any task is added
+    std::vector<int> bin_ids;
+    for (int i = 0; i < (int)m_bin_tasks.size(); i++)
+    {
+        m_bin_tasks[i].renderer = this;
+        m_bin_tasks[i].index = i;
+        m_bin_tasks[i].bins.assign(m_tiles_x * m_tiles_y, std::vector<int>());
+        bin_ids.push_back(m_graph.add_task("bin", bin_task, &m_bin_tasks[i]));
+    }
+    for (int i = 0; i < (int)m_raster_tasks.size(); i++)
+    {
+        m_raster_tasks[i].renderer = this;
+        m_raster_tasks[i].index = i;
+        int raster = m_graph.add_task("raster", raster_task, &m_raster_tasks[i]);
+        for (int bin : bin_ids) m_graph.add_dependency(raster, bin);
+    }
+    m_graph.start("software raster", worker_count);
+}
+
+void SoftwareRenderer::shutdown()
+{
+    m_graph.shutdown();
+}
+
+GLuint SoftwareRenderer::register_texture(const unsigned char* pixels, const TextureLayout& layout, FilterType filter_type)
+{
+    if (pixels == nullptr) return 0;
+
+    Texture texture;
+    texture.width = layout.width;
+    texture.height = layout.height;
+    texture.filter_type = filter_type;
+    texture.texels.resize((size_t)layout.width * layout.height);
+
+    // what fragment_textured.glsl does for every pixel, done once up front
+    int row_bytes = texture_storage_width(layout.format, layout.width);
+    for (int y = 0; y < layout.height; y++)
+    {
+        for (int x = 0; x < layout.width; x++)
+        {
+            size_t i = (size_t)y * layout.width + x;
+            if (layout.format == TEXTURE_RGBA8)
+            {
+                texture.texels[i] = pack_colour(pixels + i * 4);
+            }
+            else if (layout.format == TEXTURE_INDEXED8)
+            {
+                texture.texels[i] = pack_colour(layout.palette[pixels[i]]);
+            }
+            else
+            {
+                int bit = (pixels[(size_t)y * row_bytes + x / 8] >> (x % 8)) & 1;
+                texture.texels[i] = pack_colour(layout.palette[bit]);
+            }
+        }
+    }
+
+    m_textures.push_back(texture);
+    return (GLuint)m_textures.size();
+}
+
+bool SoftwareRenderer::load_textures(FilterType filter_type, GLuint texture_ids[NUM_TEXTURE_ASSETS])
+{
+    AssetLoader loader;
+    loader.start(TEXTURE_FILEPATHS, NUM_TEXTURE_ASSETS);
+    loader.wait();
+
+    for (int i = 0; i < NUM_TEXTURE_ASSETS; i++)
+    {
+        DecodedImage const& image = loader.get_image(i);
+        if (!image.loaded)
+        {
+            LOG("ERROR: could not decode " << image.filepath << ", run from the repository root");
+            return false;
+        }
+        texture_ids[i] = register_texture(image.texture.pixels.data(), image.texture, filter_type);
+    }
+    return true;
+}
+
+void SoftwareRenderer::set_clear_colour(float red, float green, float blue, float alpha)
+{
+    unsigned char rgba[4] = {
+        (unsigned char)(red * 255.0f + 0.5f), (unsigned char)(green * 255.0f + 0.5f),
+        (unsigned char)(blue * 255.0f + 0.5f), (unsigned char)(alpha * 255.0f + 0.5f)
+    };
+    m_clear_colour = pack_colour(rgba);
+}
+
+void SoftwareRenderer::begin_frame()
+{
+    m_triangles.clear();
+}
+
+void SoftwareRenderer::draw_sprite(const SpriteDraw& sprite)
+{
+    add_triangles(sprite.model_matrix, SPRITE_VERTICES, sprite.tex_coords, 6, sprite.texture_id);
+}
+
+void SoftwareRenderer::draw_text(GLuint font_texture_id, const TextBatch& batch)
+{
+    add_triangles(batch.model_matrix, batch.vertices.data(), batch.texture_coordinates.data(),
+        batch.vertex_count, font_texture_id);
+}
+
+// the vertex shader's job, straight to pixels with the top row first
+void SoftwareRenderer::add_triangles(const glm::mat4& model_matrix, const float* vertices, const float* tex_coords,
+    int vertex_count, GLuint texture_id)
+{
+    if (texture_id == 0 || texture_id > m_textures.size()) return;
+
+    glm::mat4 matrix = m_projection_matrix * m_view_matrix * model_matrix;
+    for (int first = 0; first + 3 <= vertex_count; first += 3)
+    {
+        Triangle triangle;
+        triangle.texture = (int)texture_id - 1;
+        for (int i = 0; i < 3; i++)
+        {
+            int vertex = first + i;
+            glm::vec4 clip = matrix * glm::vec4(vertices[vertex * 2], vertices[vertex * 2 + 1], 0.0f, 1.0f);
+            triangle.x[i] = (clip.x / clip.w * 0.5f + 0.5f) * m_width;
+            triangle.y[i] = (0.5f - clip.y / clip.w * 0.5f) * m_height;
+            triangle.u[i] = tex_coords[vertex * 2];
+            triangle.v[i] = tex_coords[vertex * 2 + 1];
+        }
+        m_triangles.push_back(triangle);
+    }
+}
+
+void SoftwareRenderer::setup_triangle(Triangle& triangle) const
+{
+    float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0])
+        - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+    triangle.visible = area != 0.0f;
+    if (!triangle.visible) return;
+
+    // no culling, just wind everything the same way round
+    if (area < 0.0f)
+    {
+        std::swap(triangle.x[1], triangle.x[2]);
+        std::swap(triangle.y[1], triangle.y[2]);
+        std::swap(triangle.u[1], triangle.u[2]);
+        std::swap(triangle.v[1], triangle.v[2]);
+        area = -area;
+    }
+
+    // Edge i runs from vertex i to the next one. Two triangles sharing an edge
+    // get exactly negated coefficients, and the top left rule gives the pixels
+    // right on it to only one of them, so a quad's diagonal is never blended twice
+    for (int i = 0; i < 3; i++)
+    {
+        int j = (i + 1) % 3;
+        triangle.edge_a[i] = triangle.y[i] - triangle.y[j];
+        triangle.edge_b[i] = triangle.x[j] - triangle.x[i];
+        triangle.edge_c[i] = triangle.x[i] * triangle.y[j] - triangle.y[i] * triangle.x[j];
+        triangle.top_left[i] = triangle.edge_a[i] > 0.0f || (triangle.edge_a[i] == 0.0f && triangle.edge_b[i] > 0.0f);
+    }
+
+    // the edge opposite a vertex is its barycentric weight
+    float inverse_area = 1.0f / area;
+    const float* a = triangle.edge_a;
+    const float* b = triangle.edge_b;
+    const float* c = triangle.edge_c;
+    triangle.u_dx = (a[1] * triangle.u[0] + a[2] * triangle.u[1] + a[0] * triangle.u[2]) * inverse_area;
+    triangle.u_dy = (b[1] * triangle.u[0] + b[2] * triangle.u[1] + b[0] * triangle.u[2]) * inverse_area;
+    triangle.u_0  = (c[1] * triangle.u[0] + c[2] * triangle.u[1] + c[0] * triangle.u[2]) * inverse_area;
+    triangle.v_dx = (a[1] * triangle.v[0] + a[2] * triangle.v[1] + a[0] * triangle.v[2]) * inverse_area;
+    triangle.v_dy = (b[1] * triangle.v[0] + b[2] * triangle.v[1] + b[0] * triangle.v[2]) * inverse_area;
+    triangle.v_0  = (c[1] * triangle.v[0] + c[2] * triangle.v[1] + c[0] * triangle.v[2]) * inverse_area;
+
+    float min_x = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+    float max_x = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+    float min_y = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+    float max_y = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+    triangle.min_x = (int)std::max(0.0f, floorf(min_x));
+    triangle.min_y = (int)std::max(0.0f, floorf(min_y));
+    triangle.max_x = (int)std::min((float)m_width - 1.0f, ceilf(max_x));
+    triangle.max_y = (int)std::min((float)m_height - 1.0f, ceilf(max_y));
+    triangle.visible = triangle.min_x <= triangle.max_x && triangle.min_y <= triangle.max_y;
+}
+
+void SoftwareRenderer::end_frame()
+{
+    TRACE_ZONE("software raster");
+    auto start = std::chrono::steady_clock::now();
+
+    m_graph.run();
+
+    m_stats.triangles = (int)m_triangles.size();
+    m_stats.binned = 0;
+    m_stats.pixels = 0;
+    m_stats.bin_ms = 0.0f;
+    m_stats.raster_ms = 0.0f;
+    for (const BinTask& task : m_bin_tasks)
+    {
+        for (const std::vector<int>& bin : task.bins) m_stats.binned += (int)bin.size();
+        m_stats.bin_ms = std::max(m_stats.bin_ms, task.ms);
+    }
+    for (const RasterTask& task : m_raster_tasks)
+    {
+        m_stats.pixels += task.pixels;
+        m_stats.raster_ms = std::max(m_stats.raster_ms, task.ms);
+    }
+    m_stats.frame_ms = (float)ms_since(start);
+}
+
+void SoftwareRenderer::bin_task(void* data)
+{
+    auto start = std::chrono::steady_clock::now();
+    BinTask& task = *(BinTask*)data;
+    SoftwareRenderer& renderer = *task.renderer;
+
+    for (std::vector<int>& bin : task.bins) bin.clear();
+
+    // a contiguous run each, so reading the bins in task order is submit order
+    int count = (int)renderer.m_triangles.size();
+    int task_count = (int)renderer.m_bin_tasks.size();
+    int first = (int)((int64_t)count * task.index / task_count);
+    int last = (int)((int64_t)count * (task.index + 1) / task_count);
+
+    for (int i = first; i < last; i++)
+    {
+        Triangle& triangle = renderer.m_triangles[i];
+        renderer.setup_triangle(triangle);
+        if (!triangle.visible) continue;
+
+        for (int tile_y = triangle.min_y / SOFTWARE_TILE_SIZE; tile_y <= triangle.max_y / SOFTWARE_TILE_SIZE; tile_y++)
+        {
+            for (int tile_x = triangle.min_x / SOFTWARE_TILE_SIZE; tile_x <= triangle.max_x / SOFTWARE_TILE_SIZE; tile_x++)
+            {
+                task.bins[tile_y * renderer.m_tiles_x + tile_x].push_back(i);
+            }
+        }
+    }
+    task.ms = (float)ms_since(start);
+}
+
+void SoftwareRenderer::raster_task(void* data)
+{
+    auto start = std::chrono::steady_clock::now();
+    RasterTask& task = *(RasterTask*)data;
+    SoftwareRenderer& renderer = *task.renderer;
+
+    // every n-th tile rather than a block, the busy ones tend to be next to each other
+    task.pixels = 0;
+    int tile_count = renderer.m_tiles_x * renderer.m_tiles_y;
+    for (int tile = task.index; tile < tile_count; tile += (int)renderer.m_raster_tasks.size())
+    {
+        renderer.raster_tile(tile, task.pixels);
+    }
+    task.ms = (float)ms_since(start);
+}
+
+void SoftwareRenderer::raster_tile(int tile, uint64_t& pixels)
+{
+    int x0 = (tile % m_tiles_x) * SOFTWARE_TILE_SIZE;
+    int y0 = (tile / m_tiles_x) * SOFTWARE_TILE_SIZE;
+    int x1 = std::min(x0 + SOFTWARE_TILE_SIZE, m_width);
+    int y1 = std::min(y0 + SOFTWARE_TILE_SIZE, m_height);
+
+    for (int y = y0; y < y1; y++)
+    {
+        fill(&m_pixels[(size_t)y * m_width + x0], x1 - x0, m_clear_colour);
+    }
+
+    for (const BinTask& task : m_bin_tasks)
+    {
+        for (int triangle : task.bins[tile])
+        {
+            raster_triangle(m_triangles[triangle], x0, y0, x1, y1, pixels);
+        }
+    }
+}
+
+void SoftwareRenderer::raster_triangle(const Triangle& triangle, int tile_x0, int tile_y0, int tile_x1, int tile_y1,
+    uint64_t& pixels)
+{
+    const Texture& texture = m_textures[triangle.texture];
+    float texture_width = (float)texture.width;
+    float texture_height = (float)texture.height;
+
+    int first_row = std::max(triangle.min_y, tile_y0);
+    int last_row = std::min(triangle.max_y, tile_y1 - 1);
+    for (int y = first_row; y <= last_row; y++)
+    {
+        float centre_y = (float)y + 0.5f;
+        int start = std::max(triangle.min_x, tile_x0);
+        int end = std::min(triangle.max_x, tile_x1 - 1);
+
+        // Where each edge crosses this row gives the span outright. The
+        // crossing is worked out the same way from either side of a shared
+        // edge, so ceil() on one side and ceil() - 1 on the other never overlap
+        for (int i = 0; i < 3 && start <= end; i++)
+        {
+            float a = triangle.edge_a[i];
+            float row = triangle.edge_b[i] * centre_y + triangle.edge_c[i];
+            if (a == 0.0f)
+            {
+                if (row < 0.0f || (row == 0.0f && !triangle.top_left[i])) start = end + 1;
+                continue;
+            }
+
+            float crossing = -row / a - 0.5f;
+            crossing = std::max(-1.0f, std::min(crossing, (float)m_width + 1.0f));
+            if (a > 0.0f) start = std::max(start, (int)ceilf(crossing));
+            else          end = std::min(end, (int)ceilf(crossing) - 1);
+        }
+        if (start > end) continue;
+        pixels += end - start + 1;
+
+        uint32_t* destination = &m_pixels[(size_t)y * m_width];
+        float u_row = triangle.u_dy * centre_y + triangle.u_0;
+        float v_row = triangle.v_dy * centre_y + triangle.v_0;
+
+        int x = start;
+#ifdef SOFTWARE_SSE2
+        // texture coordinates four at a time, then the blend. The fetches stay
+        // scalar, SSE2 has no gather
+        __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        __m128 u_dx = _mm_set1_ps(triangle.u_dx), v_dx = _mm_set1_ps(triangle.v_dx);
+        __m128 u_start = _mm_set1_ps(u_row), v_start = _mm_set1_ps(v_row);
+        __m128 u_scale = _mm_set1_ps(texture_width), v_scale = _mm_set1_ps(texture_height);
+        for (; x + 3 <= end; x += 4)
+        {
+            __m128 centre_x = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            float u[4], v[4];
+            _mm_storeu_ps(u, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(u_dx, centre_x), u_start), u_scale));
+            _mm_storeu_ps(v, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(v_dx, centre_x), v_start), v_scale));
+
+            uint32_t source[4];
+            for (int i = 0; i < 4; i++)
+            {
+                source[i] = sample(texture.texels.data(), texture.width, texture.height, texture.filter_type, u[i], v[i]);
+            }
+            blend_4(source, destination + x);
+        }
+#endif
+        for (; x <= end; x++)
+        {
+            float centre_x = (float)x + 0.5f;
+            float u = (triangle.u_dx * centre_x + u_row) * texture_width;
+            float v = (triangle.v_dx * centre_x + v_row) * texture_height;
+            uint32_t source = sample(texture.texels.data(), texture.width, texture.height, texture.filter_type, u, v);
+            destination[x] = blend(source, destination[x]);
+        }
+    }
+}
+
+ImageDiff compare_images(const uint32_t* a, const uint32_t* b, int pixel_count, int threshold)
+{
+    ImageDiff diff = {};
+    for (int i = 0; i < pixel_count; i++)
+    {
+        int worst = 0;
+        // alpha isn't saved in the PPMs, so only colour counts
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            int difference = abs((int)((a[i] >> shift) & 0xFF) - (int)((b[i] >> shift) & 0xFF));
+            worst = std::max(worst, difference);
+        }
+        if (worst > threshold) diff.differing_pixels++;
+        diff.max_difference = std::max(diff.max_difference, worst);
+    }
+    return diff;
+}
+
+bool SoftwareRenderer::write_ppm(const char* filepath) const
+{
+    std::vector<unsigned char> scratch;
+    return ::write_ppm(filepath, (const unsigned char*)m_pixels.data(), m_width, m_height, false, scratch);
+}
+
+bool read_ppm(const char* filepath, std::vector<uint32_t>& pixels, int& width, int& height)
+{
+    FILE* file = fopen(filepath, "rb");
+    if (file == nullptr) return false;
+
+    int max_value = 0;
+    bool ok = fscanf(file, "P6 %d %d %d", &width, &height, &max_value) == 3 && max_value == 255
+        && width > 0 && height > 0 && fgetc(file) != EOF;
+
+    std::vector<unsigned char> rgb;
+    if (ok)
+    {
+        rgb.resize((size_t)width * height * 3);
+        ok = fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    }
+    fclose(file);
+    if (!ok) return false;
+
+    pixels.resize((size_t)width * height);
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        unsigned char rgba[4] = { rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], 255 };
+        pixels[i] = pack_colour(rgba);
+    }
+    return true;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/mat4x4.hpp"
+
+#include "Entity.h"
+#include "Frame.h"
+#include "TaskGraph.h"
+#include "Text.h"
+#include "TextureEncoding.h"
+
+// ----- SOFTWARE RENDERER ----- //
+// Draws the same frames GLFrameRenderer does (see Frame.h), into memory
+// instead of a window, so frames can be rendered with no GPU or display (golden
+// images, rendering cost benchmarks). It does just what the game asks of GL:
+// textured triangles, SRC_ALPHA / ONE_MINUS_SRC_ALPHA blending, NEAREST or
+// LINEAR sampling with GL_REPEAT, and the low colour formats the fragment
+// shader expands.
+//
+// Draws are only queued until end_frame(). That splits the screen into tiles,
+// bins the triangles into them on the task graph's workers and then rasterises
+// the tiles in parallel, each tile going through its triangles in submit order
+// so blending comes out the same as GL. Spans are cleared, shaded and blended
+// four pixels at a time with SSE2 where there is one.
+//
+// Pixels are RGBA, 8 bits a channel, top row first.
+
+constexpr int SOFTWARE_TILE_SIZE = 64;
+
+struct SoftwareStats
+{
+    int      triangles;        // submitted last frame
+    int      binned;           // triangle and tile pairs
+    uint64_t pixels;           // covered pixels shaded
+    float    bin_ms;           // slowest bin task
+    float    raster_ms;        // slowest raster task
+    float    frame_ms;         // end_frame() wall time
+};
+
+class SoftwareRenderer : public FrameRenderer
+{
+public:
+    // 0 workers does everything on the calling thread
+    void start(int width, int height, int worker_count);
+    void shutdown();
+
+    // copies the pixels, expanding low colour ones, and returns the id sprites
+    // and text refer to it by. Anything not registered draws as nothing
+    GLuint register_texture(const unsigned char* pixels, const TextureLayout& layout, FilterType filter_type);
+    // decodes and registers every TextureAsset (see Frame.h), false if any
+    // of them couldn't be read
+    bool load_textures(FilterType filter_type, GLuint texture_ids[NUM_TEXTURE_ASSETS]);
+
+    void set_view_matrix(const glm::mat4& matrix)       { m_view_matrix = matrix; }
+    void set_projection_matrix(const glm::mat4& matrix) { m_projection_matrix = matrix; }
+    void set_clear_colour(float red, float green, float blue, float alpha);
+
+    // the FrameRenderer calls, drawing happens in end_frame()
+    void begin_frame() override;
+    void draw_sprite(const SpriteDraw& sprite) override;
+    void draw_text(GLuint font_texture_id, const TextBatch& batch) override;
+    void end_frame() override;
+
+    const uint32_t*      const get_pixels() const { return m_pixels.data(); }
+    int                  const get_width()  const { return m_width; }
+    int                  const get_height() const { return m_height; }
+    SoftwareStats const&       get_stats()  const { return m_stats; }
+
+    // binary PPM, alpha is dropped
+    bool write_ppm(const char* filepath) const;
+
+private:
+    struct Texture
+    {
+        int                   width;
+        int                   height;
+        FilterType            filter_type;
+        std::vector<uint32_t> texels;      // always RGBA
+    };
+
+    // screen space once submitted, the rest is filled in by the bin task
+    struct Triangle
+    {
+        float x[3], y[3];
+        float u[3], v[3];
+        int   texture;                     // index into m_textures
+
+        // edge functions, inside is >= 0 (> 0 off the top left edges)
+        float edge_a[3], edge_b[3], edge_c[3];
+        bool  top_left[3];
+        // u and v as planes over the screen, du = u_dx * x + u_dy * y + u_0
+        float u_dx, u_dy, u_0;
+        float v_dx, v_dy, v_0;
+        int   min_x, min_y, max_x, max_y;  // inclusive pixel bounds, clipped
+        bool  visible;
+    };
+
+    // each bin task takes a run of triangles and sorts them into its own bins,
+    // one per tile, so no two tasks ever write the same list
+    struct BinTask
+    {
+        SoftwareRenderer*             renderer;
+        int                           index;
+        std::vector<std::vector<int>> bins;
+        float                         ms;
+    };
+
+    struct RasterTask
+    {
+        SoftwareRenderer* renderer;
+        int               index;
+        uint64_t          pixels;
+        float             ms;
+    };
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_tiles_x = 0;
+    int m_tiles_y = 0;
+
+    glm::mat4 m_view_matrix = glm::mat4(1.0f);
+    glm::mat4 m_projection_matrix = glm::mat4(1.0f);
+    uint32_t  m_clear_colour = 0;
+
+    std::vector<Texture>  m_textures;
+    std::vector<Triangle> m_triangles;
+    std::vector<uint32_t> m_pixels;
+
+    TaskGraph               m_graph;
+    std::vector<BinTask>    m_bin_tasks;
+    std::vector<RasterTask> m_raster_tasks;
+    SoftwareStats           m_stats = {};
+
+    void add_triangles(const glm::mat4& model_matrix, const float* vertices, const float* tex_coords,
+        int vertex_count, GLuint texture_id);
+    void setup_triangle(Triangle& triangle) const;
+    void raster_tile(int tile, uint64_t& pixels);
+    void raster_triangle(const Triangle& triangle, int tile_x0, int tile_y0, int tile_x1, int tile_y1,
+        uint64_t& pixels);
+
+    static void bin_task(void* data);
+    static void raster_task(void* data);
+};
+
+// how far apart two frames are, for golden image checks
+struct ImageDiff
+{
+    int      differing_pixels;    // any channel off by more than the threshold
+    int      max_difference;      // largest single channel difference
+};
+
+ImageDiff compare_images(const uint32_t* a, const uint32_t* b, int pixel_count, int threshold);
+// binary RGB PPM from write_ppm(), back out as RGBA
+bool read_ppm(const char* filepath, std::vector<uint32_t>& pixels, int& width, int& height);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed size ring for exactly one producer thread and one consumer thread, no
+// locks and no allocation. CAPACITY has to be a power of two.
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+private:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    T                   m_items[CAPACITY];
+    std::atomic<size_t> m_head{ 0 };   // next to read, written by the consumer
+    std::atomic<size_t> m_tail{ 0 };   // next to write, written by the producer
+
+public:
+    // producer: false if the queue is full and the item was dropped
+    bool push(const T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == CAPACITY) return false;
+
+        m_items[tail & (CAPACITY - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: the oldest item without removing it, nullptr if empty
+    const T* peek() const
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return nullptr;
+        return &m_items[head & (CAPACITY - 1)];
+    }
+
+    // consumer: drops the item peek() returned
+    void pop()
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    size_t const get_size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+};
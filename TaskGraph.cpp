@@ -0,0 +1,187 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "TaskGraph.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+void TaskGraph::start(const char* name, int worker_count)
+{
+    m_name = name;
+    m_worker_count = worker_count;
+    m_stopping = false;
+    for (int i = 0; i < worker_count; i++)
+    {
+        m_workers.emplace_back(&TaskGraph::worker, this, i + 1);
+    }
+}
+
+void TaskGraph::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_task_ready.notify_all();
+
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+    m_workers.clear();
+}
+
+int TaskGraph::add_task(const char* name, TaskFunction function, void* data, bool pinned)
+{
+    Task task = {};
+    task.name = name;
+    task.function = function;
+    task.data = data;
+    task.pinned = pinned;
+    m_tasks.push_back(task);
+
+    // sized for the worst case here so run() never has to grow them
+    m_ready.reserve(m_tasks.size());
+    m_pinned_ready.reserve(m_tasks.size());
+    return (int)m_tasks.size() - 1;
+}
+
+void TaskGraph::add_dependency(int task, int depends_on)
+{
+    assert(depends_on < task);
+    m_tasks[task].dependencies.push_back(depends_on);
+    m_tasks[depends_on].dependents.push_back(task);
+}
+
+void TaskGraph::run()
+{
+    m_run_start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_unfinished = (int)m_tasks.size();
+    for (size_t i = 0; i < m_tasks.size(); i++)
+    {
+        m_tasks[i].remaining = (int)m_tasks[i].dependencies.size();
+        if (m_tasks[i].remaining == 0) make_ready((int)i);
+    }
+    m_task_ready.notify_all();
+
+    // pitch in until everything is done, pinned tasks first since only we can run them
+    while (m_unfinished > 0)
+    {
+        int task = -1;
+        if (!m_pinned_ready.empty())
+        {
+            task = m_pinned_ready.back();
+            m_pinned_ready.pop_back();
+        }
+        else if (!m_ready.empty())
+        {
+            task = m_ready.back();
+            m_ready.pop_back();
+        }
+
+        if (task < 0)
+        {
+            m_task_done.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        execute(task, 0);
+        lock.lock();
+        finish(task);
+    }
+    lock.unlock();
+
+    // tasks are in dependency order, so one pass finds the longest chain
+    m_critical_path_ms = 0.0;
+    for (size_t i = 0; i < m_tasks.size(); i++)
+    {
+        Task& task = m_tasks[i];
+        double longest_dependency = 0.0;
+        for (size_t j = 0; j < task.dependencies.size(); j++)
+        {
+            longest_dependency = std::max(longest_dependency, m_tasks[task.dependencies[j]].path_ms);
+        }
+
+        double task_ms = task.end_ms - task.start_ms;
+        task.path_ms = longest_dependency + task_ms;
+        task.total_ms += task_ms;
+        task.worst_ms = std::max(task.worst_ms, task_ms);
+        m_critical_path_ms = std::max(m_critical_path_ms, task.path_ms);
+    }
+
+    std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - m_run_start;
+    m_wall_ms = wall.count();
+    m_total_wall_ms += m_wall_ms;
+    m_total_critical_path_ms += m_critical_path_ms;
+    m_runs++;
+}
+
+void TaskGraph::worker(int thread)
+{
+    TRACE_THREAD_NAME(m_name);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_task_ready.wait(lock, [this] { return m_stopping || !m_ready.empty(); });
+        if (m_stopping) return;
+
+        int task = m_ready.back();
+        m_ready.pop_back();
+
+        lock.unlock();
+        execute(task, thread);
+        lock.lock();
+        finish(task);
+    }
+}
+
+void TaskGraph::execute(int task, int thread)
+{
+    Task& current = m_tasks[task];
+    TRACE_ZONE(current.name);
+    std::chrono::duration<double, std::milli> start = std::chrono::steady_clock::now() - m_run_start;
+    current.function(current.data);
+    std::chrono::duration<double, std::milli> end = std::chrono::steady_clock::now() - m_run_start;
+
+    current.start_ms = start.count();
+    current.end_ms = end.count();
+    current.thread = thread;
+}
+
+void TaskGraph::finish(int task)
+{
+    Task& finished = m_tasks[task];
+    for (size_t i = 0; i < finished.dependents.size(); i++)
+    {
+        int dependent = finished.dependents[i];
+        if (--m_tasks[dependent].remaining == 0) make_ready(dependent);
+    }
+
+    m_unfinished--;
+    m_task_ready.notify_all();
+    m_task_done.notify_one();
+}
+
+void TaskGraph::make_ready(int task)
+{
+    if (m_tasks[task].pinned) m_pinned_ready.push_back(task);
+    else m_ready.push_back(task);
+}
+
+void TaskGraph::report() const
+{
+    if (m_runs == 0) return;
+
+    LOG("Task graph '" << m_name << "' over " << m_runs << " runs, " << m_worker_count << " workers: "
+        << m_total_wall_ms / m_runs << " ms average, critical path " << m_total_critical_path_ms / m_runs << " ms");
+    for (size_t i = 0; i < m_tasks.size(); i++)
+    {
+        LOG("  " << m_tasks[i].name << ": " << m_tasks[i].total_ms / m_runs << " ms average, "
+            << m_tasks[i].worst_ms << " ms worst");
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of tasks with dependencies between them, run once per frame (or
+// step). Each task starts as soon as everything it depends on has finished,
+// so independent ones end up running side by side on the workers.
+//
+// Tasks are set up once with add_task/add_dependency; run() after that never
+// allocates. The thread calling run() works through tasks too, and is the only
+// one allowed to run pinned tasks, which is where the GL calls go.
+class TaskGraph
+{
+public:
+    typedef void (*TaskFunction)(void* data);
+
+    // 0 workers runs everything on the calling thread, in dependency order
+    void start(const char* name, int worker_count);
+    void shutdown();
+
+    // returns the id to use with add_dependency
+    int  add_task(const char* name, TaskFunction function, void* data, bool pinned = false);
+    // depends_on has to be added before task, which keeps the graph acyclic
+    void add_dependency(int task, int depends_on);
+
+    // runs every task once, returns when they have all finished
+    void run();
+
+    // per task averages and the critical path, logged at shutdown
+    void report() const;
+
+    int         const get_task_count()       const { return (int)m_tasks.size(); }
+    const char* const get_task_name(int task) const { return m_tasks[task].name; }
+    // from the last run
+    float       const get_task_ms(int task)   const { return (float)(m_tasks[task].end_ms - m_tasks[task].start_ms); }
+    float       const get_critical_path_ms()  const { return (float)m_critical_path_ms; }
+    float       const get_wall_ms()           const { return (float)m_wall_ms; }
+
+private:
+    struct Task
+    {
+        const char*      name;
+        TaskFunction     function;
+        void*            data;
+        bool             pinned;
+        std::vector<int> dependencies;
+        std::vector<int> dependents;
+        int              remaining;        // unfinished dependencies, guarded by m_mutex
+
+        // last run, in ms since it started
+        double start_ms;
+        double end_ms;
+        int    thread;                     // 0 is the caller, workers count from 1
+        double path_ms;                    // longest chain of work ending with this task
+
+        double total_ms;
+        double worst_ms;
+    };
+
+    const char*        m_name = "";
+    int                m_worker_count = 0;
+    std::vector<Task>  m_tasks;
+
+    std::vector<std::thread> m_workers;
+    std::mutex               m_mutex;
+    std::condition_variable  m_task_ready;   // wakes workers
+    std::condition_variable  m_task_done;    // wakes the caller
+    std::vector<int>         m_ready;        // guarded by m_mutex
+    std::vector<int>         m_pinned_ready; // guarded by m_mutex
+    int                      m_unfinished = 0;
+    bool                     m_stopping = false;
+
+    std::chrono::steady_clock::time_point m_run_start;
+
+    uint64_t m_runs = 0;
+    double   m_wall_ms = 0.0;
+    double   m_critical_path_ms = 0.0;
+    double   m_total_wall_ms = 0.0;
+    double   m_total_critical_path_ms = 0.0;
+
+    void worker(int thread);
+    void execute(int task, int thread);
+    // m_mutex has to be held
+    void finish(int task);
+    void make_ready(int task);
+};
@@ -0,0 +1,506 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "Telemetry.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr size_t SEGMENT_SIZE = TelemetryWriter::SEGMENT_BLOCKS * TELEMETRY_BLOCK_SIZE;
+    constexpr size_t FAULT_STRIDE = 4096;             // smallest page size around
+    constexpr int MAPPER_SLEEP_MS = 10;
+
+    const char* const COLUMN_NAMES[TELEMETRY_COLUMN_COUNT] = { "run", "position_x", "position_y", "velocity_x",
+        "velocity_y", "angle", "fuel", "status", "angle_dir", "thrust", "commands", "contact" };
+    const uint32_t COLUMN_WIDTHS[TELEMETRY_COLUMN_COUNT] = { 4, 4, 4, 4, 4, 4, 4, 1, 1, 1, 1, 1 };
+
+    static_assert(TELEMETRY_COLUMN_COUNT <= TELEMETRY_MAX_COLUMNS, "the header has room for so many columns");
+    static_assert(sizeof(TelemetryFileHeader) <= TELEMETRY_HEADER_SIZE, "the file header has outgrown its page");
+    static_assert(sizeof(TelemetryBlockHeader) <= TELEMETRY_BLOCK_HEADER_SIZE, "the block header has outgrown its room");
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+        "counts in the file are read and written as atomics in place");
+
+    // the counts that get published sit in the mapping, not in an std::atomic
+    template <typename T>
+    std::atomic<T>& as_atomic(T& value)
+    {
+        return *reinterpret_cast<std::atomic<T>*>(&value);
+    }
+
+    template <typename T>
+    const std::atomic<T>& as_atomic(const T& value)
+    {
+        return *reinterpret_cast<const std::atomic<T>*>(&value);
+    }
+}
+
+const char* get_column_name(TelemetryColumn column)
+{
+    return COLUMN_NAMES[column];
+}
+
+uint32_t get_column_width(TelemetryColumn column)
+{
+    return COLUMN_WIDTHS[column];
+}
+
+size_t get_column_offset(TelemetryColumn column)
+{
+    size_t offset = TELEMETRY_BLOCK_HEADER_SIZE;
+    for (int i = 0; i < column; i++)
+    {
+        offset += (size_t)COLUMN_WIDTHS[i] * TELEMETRY_BLOCK_TICKS;
+    }
+    return offset;
+}
+
+void fill_telemetry_tick(TelemetryTick& tick, GameState& state, const SimInput& input, EntityStatus status_before,
+    uint32_t run)
+{
+    Entity* ship = state.ship;
+    glm::vec3 position = ship->get_position();
+    glm::vec3 velocity = ship->get_velocity();
+    EntityStatus status = ship->get_status();
+
+    tick.run = run;
+    tick.position_x = position.x;
+    tick.position_y = position.y;
+    tick.velocity_x = velocity.x;
+    tick.velocity_y = velocity.y;
+    tick.angle = ship->get_angle();
+    tick.fuel = ship->get_fuel();
+    tick.status = (uint8_t)status;
+    tick.angle_dir = (uint8_t)input.angle_dir;
+    tick.thrust = input.using_fuel ? 1 : 0;
+    tick.commands = (uint8_t)input.commands;
+    tick.contact = TELEMETRY_NO_CONTACT;
+
+    // only on the one step the ship stops, so the collision checks cost nothing
+    // the rest of the time
+    if (status_before == ACTIVE && (status == LANDED || status == CRASHED))
+    {
+        for (int i = 0; i < NUM_PLATFORMS; i++)
+        {
+            if (ship->check_collision_SAT(&state.platforms[i]))
+            {
+                tick.contact = (uint8_t)i;
+                break;
+            }
+        }
+    }
+}
+
+// ----- WRITER ----- //
+TelemetryWriter::~TelemetryWriter()
+{
+    close();
+}
+
+bool TelemetryWriter::open(const char* filepath, int sim_hz, const Entity& ship, const Entity* platforms, int platform_count)
+{
+    close();
+
+#ifdef _WINDOWS
+    HANDLE file = CreateFileA(filepath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    m_file = file;
+#else
+    m_file = ::open(filepath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_file < 0) return false;
+#endif
+
+    m_mapped_segments = 0;
+    m_map_failed = false;
+    m_block_count = 0;
+    m_header = (TelemetryFileHeader*)map_range(0, TELEMETRY_HEADER_SIZE);
+    m_segment = m_header != nullptr ? map_segment() : nullptr;
+    if (m_segment == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    TelemetryFileHeader& header = *m_header;
+    header.magic = TELEMETRY_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.block_ticks = TELEMETRY_BLOCK_TICKS;
+    header.column_count = TELEMETRY_COLUMN_COUNT;
+    header.block_size = TELEMETRY_BLOCK_SIZE;
+    header.sim_hz = (uint32_t)sim_hz;
+    header.platform_count = (uint32_t)std::min(platform_count, TELEMETRY_MAX_PLATFORMS);
+    // build_level() sets every collision box to the entity's scale
+    header.ship_width = ship.get_scale().x;
+    header.ship_height = ship.get_scale().y;
+    for (uint32_t i = 0; i < header.platform_count; i++)
+    {
+        glm::vec3 position = platforms[i].get_position();
+        glm::vec3 scale = platforms[i].get_scale();
+        header.platforms[i] = { position.x, position.y, scale.x, scale.y, platforms[i].is_enemy() ? 1u : 0u };
+    }
+    for (int i = 0; i < TELEMETRY_COLUMN_COUNT; i++)
+    {
+        TelemetryColumnInfo& column = header.columns[i];
+        strncpy(column.name, COLUMN_NAMES[i], sizeof(column.name) - 1);
+        column.width = COLUMN_WIDTHS[i];
+        column.offset = (uint32_t)get_column_offset((TelemetryColumn)i);
+    }
+    as_atomic(header.block_count).store(0, std::memory_order_release);
+
+    m_segment_blocks = 0;
+    m_block = nullptr;
+    m_ticks = 0;
+    m_dropped = 0;
+    m_stopping = false;
+    m_mapper = std::thread(&TelemetryWriter::mapper, this);
+    return true;
+}
+
+void TelemetryWriter::close()
+{
+    if (m_mapper.joinable())
+    {
+        m_stopping.store(true, std::memory_order_release);
+        m_mapper.join();
+    }
+
+    // nothing can be mapped when the file is trimmed
+    unsigned char* const* retired;
+    while ((retired = m_retired.peek()) != nullptr)
+    {
+        unmap(*retired, SEGMENT_SIZE);
+        m_retired.pop();
+    }
+    if (m_segment != nullptr) unmap(m_segment, SEGMENT_SIZE);
+    unsigned char* next = m_next_segment.exchange(nullptr);
+    if (next != nullptr) unmap(next, SEGMENT_SIZE);
+    if (m_header != nullptr) unmap(m_header, TELEMETRY_HEADER_SIZE);
+    m_segment = nullptr;
+    m_block = nullptr;
+    m_header = nullptr;
+
+    uint64_t size = TELEMETRY_HEADER_SIZE + m_block_count * TELEMETRY_BLOCK_SIZE;
+#ifdef _WINDOWS
+    if (m_file != nullptr)
+    {
+        LARGE_INTEGER end;
+        end.QuadPart = (LONGLONG)size;
+        SetFilePointerEx((HANDLE)m_file, end, NULL, FILE_BEGIN);
+        SetEndOfFile((HANDLE)m_file);
+        CloseHandle((HANDLE)m_file);
+        m_file = nullptr;
+    }
+#else
+    if (m_file >= 0)
+    {
+        if (ftruncate(m_file, (off_t)size) != 0) LOG("Couldn't trim the telemetry file");
+        ::close(m_file);
+        m_file = -1;
+    }
+#endif
+}
+
+void TelemetryWriter::record(uint64_t step, const TelemetryTick& tick)
+{
+    if (m_header == nullptr) return;
+
+    // a gap (dropped steps) starts a new block so rows always follow on from first_step
+    if (m_block != nullptr && (m_block_ticks == TELEMETRY_BLOCK_TICKS || step != m_next_step)) m_block = nullptr;
+    if (m_block == nullptr && !begin_block(step))
+    {
+        m_dropped++;
+        return;
+    }
+
+    uint32_t row = m_block_ticks;
+    ((uint32_t*)m_columns[COLUMN_RUN])[row] = tick.run;
+    ((float*)m_columns[COLUMN_POSITION_X])[row] = tick.position_x;
+    ((float*)m_columns[COLUMN_POSITION_Y])[row] = tick.position_y;
+    ((float*)m_columns[COLUMN_VELOCITY_X])[row] = tick.velocity_x;
+    ((float*)m_columns[COLUMN_VELOCITY_Y])[row] = tick.velocity_y;
+    ((float*)m_columns[COLUMN_ANGLE])[row] = tick.angle;
+    ((int32_t*)m_columns[COLUMN_FUEL])[row] = tick.fuel;
+    m_columns[COLUMN_STATUS][row] = tick.status;
+    m_columns[COLUMN_ANGLE_DIR][row] = tick.angle_dir;
+    m_columns[COLUMN_THRUST][row] = tick.thrust;
+    m_columns[COLUMN_COMMANDS][row] = tick.commands;
+    m_columns[COLUMN_CONTACT][row] = tick.contact;
+
+    // the row is there before anyone reading can see it counted
+    m_block_ticks++;
+    as_atomic(((TelemetryBlockHeader*)m_block)->tick_count).store(m_block_ticks, std::memory_order_release);
+    m_next_step = step + 1;
+    m_ticks++;
+}
+
+bool TelemetryWriter::begin_block(uint64_t step)
+{
+    if (m_segment_blocks == SEGMENT_BLOCKS)
+    {
+        // the mapper should have had the next one ready for hours
+        unsigned char* next = m_next_segment.exchange(nullptr, std::memory_order_acquire);
+        if (next == nullptr) return false;
+
+        // sixteen waiting to be unmapped can't realistically happen, if it
+        // ever did that one would just stay mapped
+        m_retired.push(m_segment);
+        m_segment = next;
+        m_segment_blocks = 0;
+    }
+
+    m_block = m_segment + (size_t)m_segment_blocks++ * TELEMETRY_BLOCK_SIZE;
+    m_block_ticks = 0;
+    for (int i = 0; i < TELEMETRY_COLUMN_COUNT; i++)
+    {
+        m_columns[i] = m_block + get_column_offset((TelemetryColumn)i);
+    }
+    TelemetryBlockHeader* header = (TelemetryBlockHeader*)m_block;
+    header->magic = TELEMETRY_BLOCK_MAGIC;
+    header->first_step = step;
+    header->index = m_block_count;
+    as_atomic(header->tick_count).store(0, std::memory_order_relaxed);
+
+    m_block_count++;
+    as_atomic(m_header->block_count).store(m_block_count, std::memory_order_release);
+    return true;
+}
+
+// ----- MAPPER ----- //
+void TelemetryWriter::mapper()
+{
+    TRACE_THREAD_NAME("telemetry mapper");
+    while (!m_stopping.load(std::memory_order_acquire))
+    {
+        unsigned char* const* retired;
+        while ((retired = m_retired.peek()) != nullptr)
+        {
+            unmap(*retired, SEGMENT_SIZE);
+            m_retired.pop();
+        }
+
+        if (m_next_segment.load(std::memory_order_acquire) == nullptr)
+        {
+            TRACE_ZONE("map telemetry segment");
+            unsigned char* segment = map_segment();
+            if (segment != nullptr) m_next_segment.store(segment, std::memory_order_release);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(MAPPER_SLEEP_MS));
+    }
+}
+
+unsigned char* TelemetryWriter::map_segment()
+{
+    unsigned char* segment = (unsigned char*)map_range(TELEMETRY_HEADER_SIZE + m_mapped_segments * SEGMENT_SIZE,
+        SEGMENT_SIZE);
+    if (segment == nullptr)
+    {
+        // keeps trying, but only says so once
+        if (!m_map_failed) LOG("Couldn't grow the telemetry file, steps will be dropped until it can");
+        m_map_failed = true;
+        return nullptr;
+    }
+    m_map_failed = false;
+    m_mapped_segments++;
+
+    // fault every page in now so the stepping thread never takes the hit
+    volatile unsigned char* pages = segment;
+    for (size_t i = 0; i < SEGMENT_SIZE; i += FAULT_STRIDE)
+    {
+        pages[i] = 0;
+    }
+    return segment;
+}
+
+void* TelemetryWriter::map_range(uint64_t offset, size_t size)
+{
+#ifdef _WINDOWS
+    // a mapping bigger than the file grows the file
+    uint64_t end = offset + size;
+    HANDLE mapping = CreateFileMappingA((HANDLE)m_file, NULL, PAGE_READWRITE, (DWORD)(end >> 32), (DWORD)end, NULL);
+    if (mapping == NULL) return nullptr;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, size);
+    // the view keeps its own reference to the mapping
+    CloseHandle(mapping);
+    return view;
+#else
+    // real blocks rather than a sparse file, so a full disk fails here and not
+    // as a SIGBUS on some store in record()
+#ifdef __linux__
+    if (posix_fallocate(m_file, (off_t)offset, (off_t)size) != 0) return nullptr;
+#else
+    if (ftruncate(m_file, (off_t)(offset + size)) != 0) return nullptr;
+#endif
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, (off_t)offset);
+    return view == MAP_FAILED ? nullptr : view;
+#endif
+}
+
+void TelemetryWriter::unmap(void* data, size_t size)
+{
+#ifdef _WINDOWS
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+// ----- READER ----- //
+TelemetryReader::~TelemetryReader()
+{
+    close();
+}
+
+bool TelemetryReader::open(const char* filepath)
+{
+    close();
+
+#ifdef _WINDOWS
+    // the game may well still have it open for writing
+    HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    m_file = file;
+#else
+    m_file = ::open(filepath, O_RDONLY);
+    if (m_file < 0) return false;
+#endif
+
+    if (!map())
+    {
+        close();
+        return false;
+    }
+
+    // sanity check the layout before anyone reads through it
+    const TelemetryFileHeader* header = get_header();
+    bool ok = header->magic == TELEMETRY_MAGIC && header->version == TELEMETRY_VERSION &&
+        header->block_ticks == TELEMETRY_BLOCK_TICKS && header->block_size == TELEMETRY_BLOCK_SIZE &&
+        header->column_count == TELEMETRY_COLUMN_COUNT && header->platform_count <= TELEMETRY_MAX_PLATFORMS;
+    for (int i = 0; ok && i < TELEMETRY_COLUMN_COUNT; i++)
+    {
+        const TelemetryColumnInfo& column = header->columns[i];
+        ok = strncmp(column.name, COLUMN_NAMES[i], sizeof(column.name)) == 0 && column.width == COLUMN_WIDTHS[i] &&
+            column.offset == get_column_offset((TelemetryColumn)i);
+    }
+    if (!ok)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TelemetryReader::close()
+{
+    unmap();
+#ifdef _WINDOWS
+    if (m_file != nullptr) CloseHandle((HANDLE)m_file);
+    m_file = nullptr;
+#else
+    if (m_file >= 0) ::close(m_file);
+    m_file = -1;
+#endif
+}
+
+bool TelemetryReader::refresh()
+{
+    if (m_data == nullptr) return false;
+
+#ifdef _WINDOWS
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx((HANDLE)m_file, &file_size)) return false;
+    size_t size = (size_t)file_size.QuadPart;
+#else
+    struct stat file_stat;
+    if (fstat(m_file, &file_stat) != 0) return false;
+    size_t size = (size_t)file_stat.st_size;
+#endif
+
+    if (size <= m_size) return true;
+    unmap();
+    return map();
+}
+
+uint64_t const TelemetryReader::get_block_count() const
+{
+    if (m_data == nullptr) return 0;
+
+    uint64_t started = as_atomic(get_header()->block_count).load(std::memory_order_acquire);
+    uint64_t mapped = (m_size - TELEMETRY_HEADER_SIZE) / TELEMETRY_BLOCK_SIZE;
+    return std::min(started, mapped);
+}
+
+TelemetryBlock TelemetryReader::get_block(uint64_t index) const
+{
+    const unsigned char* base = m_data + TELEMETRY_HEADER_SIZE + index * TELEMETRY_BLOCK_SIZE;
+    const TelemetryBlockHeader* header = (const TelemetryBlockHeader*)base;
+
+    TelemetryBlock block;
+    block.tick_count = std::min(as_atomic(header->tick_count).load(std::memory_order_acquire), TELEMETRY_BLOCK_TICKS);
+    block.first_step = header->first_step;
+    block.run = (const uint32_t*)(base + get_column_offset(COLUMN_RUN));
+    block.position_x = (const float*)(base + get_column_offset(COLUMN_POSITION_X));
+    block.position_y = (const float*)(base + get_column_offset(COLUMN_POSITION_Y));
+    block.velocity_x = (const float*)(base + get_column_offset(COLUMN_VELOCITY_X));
+    block.velocity_y = (const float*)(base + get_column_offset(COLUMN_VELOCITY_Y));
+    block.angle = (const float*)(base + get_column_offset(COLUMN_ANGLE));
+    block.fuel = (const int32_t*)(base + get_column_offset(COLUMN_FUEL));
+    block.status = base + get_column_offset(COLUMN_STATUS);
+    block.angle_dir = base + get_column_offset(COLUMN_ANGLE_DIR);
+    block.thrust = base + get_column_offset(COLUMN_THRUST);
+    block.commands = base + get_column_offset(COLUMN_COMMANDS);
+    block.contact = base + get_column_offset(COLUMN_CONTACT);
+    return block;
+}
+
+bool TelemetryReader::map()
+{
+#ifdef _WINDOWS
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx((HANDLE)m_file, &file_size) || file_size.QuadPart < (LONGLONG)TELEMETRY_HEADER_SIZE) return false;
+
+    HANDLE mapping = CreateFileMappingA((HANDLE)m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) return false;
+    m_data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    m_size = (size_t)file_size.QuadPart;
+#else
+    struct stat file_stat;
+    if (fstat(m_file, &file_stat) != 0 || (size_t)file_stat.st_size < TELEMETRY_HEADER_SIZE) return false;
+
+    // shared, so rows the game writes after this show up without remapping
+    void* mapping = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+    if (mapping == MAP_FAILED) return false;
+    m_data = (const unsigned char*)mapping;
+    m_size = (size_t)file_stat.st_size;
+#endif
+    return m_data != nullptr;
+}
+
+void TelemetryReader::unmap()
+{
+#ifdef _WINDOWS
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+#else
+    if (m_data != nullptr) munmap((void*)m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
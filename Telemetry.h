@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "Simulation.h"
+#include "SpscQueue.h"
+
+// ----- TELEMETRY FORMAT ----- //
+// Every simulation step's ship state, column by column, in a file that's
+// memory mapped both for writing and reading. After a 64 KiB file header come
+// fixed size blocks of TELEMETRY_BLOCK_TICKS consecutive steps. Each block is
+// a small header and then one array per column, so a query only pulls in the
+// columns it reads and can run SIMD straight down them.
+//
+// The file header's block_count and each block's tick_count only ever grow and
+// are published after the data they cover, so a reader can map the file while
+// the game is still writing it and trust everything up to those counts. The
+// file grows a segment of blocks at a time ahead of the writer and is trimmed
+// to what was written on close.
+//
+// Native endian, everything little endian in practice.
+
+constexpr uint32_t TELEMETRY_MAGIC = 0x4D544C4C;         // "LLTM"
+constexpr uint32_t TELEMETRY_BLOCK_MAGIC = 0x4B4C4254;   // "TBLK"
+constexpr uint32_t TELEMETRY_VERSION = 2;
+constexpr uint32_t TELEMETRY_BLOCK_TICKS = 8192;
+constexpr int      TELEMETRY_MAX_PLATFORMS = 8;
+constexpr int      TELEMETRY_MAX_COLUMNS = 16;
+constexpr uint8_t  TELEMETRY_NO_CONTACT = 0xFF;
+
+// 64 KiB is the mapping granularity on Windows, blocks and segments start on it
+constexpr size_t TELEMETRY_ALIGNMENT = 65536;
+constexpr size_t TELEMETRY_HEADER_SIZE = TELEMETRY_ALIGNMENT;
+constexpr size_t TELEMETRY_BLOCK_HEADER_SIZE = 256;
+
+enum TelemetryColumn
+{
+    COLUMN_RUN,             // uint32, bumped by every restart
+    COLUMN_POSITION_X,      // float
+    COLUMN_POSITION_Y,      // float
+    COLUMN_VELOCITY_X,      // float
+    COLUMN_VELOCITY_Y,      // float
+    COLUMN_ANGLE,           // float, the raw accumulator valid_collision() checks
+    COLUMN_FUEL,            // int32
+    COLUMN_STATUS,          // uint8 EntityStatus
+    COLUMN_ANGLE_DIR,       // uint8 AngleDirection
+    COLUMN_THRUST,          // uint8 0|1
+    COLUMN_COMMANDS,        // uint8 GameCommand bits
+    COLUMN_CONTACT,         // uint8 platform touched on the step the ship stopped, else TELEMETRY_NO_CONTACT
+    TELEMETRY_COLUMN_COUNT
+};
+
+constexpr size_t TELEMETRY_ROW_SIZE = 7 * 4 + 5 * 1;   // every column's width added up
+constexpr size_t TELEMETRY_BLOCK_SIZE = (TELEMETRY_BLOCK_HEADER_SIZE + TELEMETRY_ROW_SIZE * TELEMETRY_BLOCK_TICKS
+    + TELEMETRY_ALIGNMENT - 1) / TELEMETRY_ALIGNMENT * TELEMETRY_ALIGNMENT;
+
+const char* get_column_name(TelemetryColumn column);
+uint32_t get_column_width(TelemetryColumn column);
+// from the start of a block
+size_t get_column_offset(TelemetryColumn column);
+
+struct TelemetryColumnInfo
+{
+    char     name[24];
+    uint32_t width;
+    uint32_t offset;
+};
+
+struct TelemetryPlatform
+{
+    float x, y;             // where the level starts it, sharks move
+    float width, height;
+    uint32_t enemy;
+};
+
+struct TelemetryFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_ticks;
+    uint32_t column_count;
+    uint64_t block_size;
+    uint64_t block_count;   // blocks started, the last one may still be filling. Atomic
+    uint32_t sim_hz;
+    uint32_t platform_count;
+    float    ship_width, ship_height;   // collision box, so a query can tell an edge crash
+    TelemetryPlatform   platforms[TELEMETRY_MAX_PLATFORMS];
+    TelemetryColumnInfo columns[TELEMETRY_MAX_COLUMNS];
+};
+
+struct TelemetryBlockHeader
+{
+    uint32_t magic;
+    uint32_t tick_count;    // rows written so far. Atomic
+    uint64_t first_step;    // step of row 0, the rest follow on one a row
+    uint64_t index;
+};
+
+// one step's worth, what the writer is handed
+struct TelemetryTick
+{
+    uint32_t run;
+    float    position_x, position_y;
+    float    velocity_x, velocity_y;
+    float    angle;
+    int32_t  fuel;
+    uint8_t  status;
+    uint8_t  angle_dir;
+    uint8_t  thrust;
+    uint8_t  commands;
+    uint8_t  contact;
+};
+
+// the ship after a step. status_before is its status going into the step, so
+// the step it lands or crashes on can say what it hit
+void fill_telemetry_tick(TelemetryTick& tick, GameState& state, const SimInput& input, EntityStatus status_before,
+    uint32_t run);
+
+// ----- WRITER ----- //
+// Appends a row per step. record() only stores into mapped memory: a
+// background thread grows the file, maps and pre-faults the next segment
+// before it's needed and unmaps the ones that are done, so the stepping
+// thread never makes a syscall. If a segment isn't ready in time the steps
+// are dropped and counted rather than waited for.
+class TelemetryWriter
+{
+public:
+    static constexpr uint32_t SEGMENT_BLOCKS = 64;      // 20 MB, over two hours at 60 Hz
+
+    ~TelemetryWriter();
+
+    // the ship's size and the platforms are saved in the header so a query can
+    // name what was landed on and where
+    bool open(const char* filepath, int sim_hz, const Entity& ship, const Entity* platforms, int platform_count);
+    // trims the file to the blocks written
+    void close();
+
+    // stepping thread only
+    void record(uint64_t step, const TelemetryTick& tick);
+
+    bool     const is_open()     const { return m_header != nullptr; }
+    uint64_t const get_ticks()   const { return m_ticks; }
+    uint64_t const get_dropped() const { return m_dropped; }
+
+private:
+    TelemetryFileHeader* m_header = nullptr;
+    unsigned char*       m_segment = nullptr;           // the one blocks are being taken from
+    uint32_t             m_segment_blocks = 0;          // taken from it so far
+    unsigned char*       m_block = nullptr;             // filling, nullptr between blocks
+    unsigned char*       m_columns[TELEMETRY_COLUMN_COUNT];  // where each column starts in m_block
+    uint32_t             m_block_ticks = 0;
+    uint64_t             m_next_step = 0;
+    uint64_t             m_block_count = 0;
+    uint64_t             m_ticks = 0;
+    uint64_t             m_dropped = 0;
+
+    // handed between the stepping thread and the mapper
+    std::atomic<unsigned char*>      m_next_segment{ nullptr };
+    SpscQueue<unsigned char*, 16>    m_retired;
+    std::thread                      m_mapper;
+    std::atomic<bool>                m_stopping{ false };
+    uint64_t                         m_mapped_segments = 0;     // mapper only once it's running
+    bool                             m_map_failed = false;
+
+#ifdef _WINDOWS
+    void* m_file = nullptr;
+#else
+    int   m_file = -1;
+#endif
+
+    // grows the file to cover the range first
+    void* map_range(uint64_t offset, size_t size);
+    unsigned char* map_segment();
+    void unmap(void* data, size_t size);
+    void mapper();
+    bool begin_block(uint64_t step);
+};
+
+// ----- READER ----- //
+// One block's columns, pointing straight into the mapping
+struct TelemetryBlock
+{
+    uint64_t        first_step;
+    uint32_t        tick_count;
+    const uint32_t* run;
+    const float*    position_x;
+    const float*    position_y;
+    const float*    velocity_x;
+    const float*    velocity_y;
+    const float*    angle;
+    const int32_t*  fuel;
+    const uint8_t*  status;
+    const uint8_t*  angle_dir;
+    const uint8_t*  thrust;
+    const uint8_t*  commands;
+    const uint8_t*  contact;
+};
+
+// Read-only view of a telemetry file, safe to use while the game is still
+// writing it; refresh() picks up whatever's been added since
+class TelemetryReader
+{
+public:
+    ~TelemetryReader();
+
+    // false if the file is missing or isn't telemetry this build understands
+    bool open(const char* filepath);
+    void close();
+    // remaps if the file has grown, false if it couldn't be
+    bool refresh();
+
+    const TelemetryFileHeader* get_header() const { return (const TelemetryFileHeader*)m_data; }
+    // blocks that are both started and inside the current mapping
+    uint64_t const get_block_count() const;
+    // tick_count is read once here, later rows need another get_block()
+    TelemetryBlock get_block(uint64_t index) const;
+
+private:
+    const unsigned char* m_data = nullptr;
+    size_t               m_size = 0;
+
+#ifdef _WINDOWS
+    void* m_file = nullptr;
+#else
+    int   m_file = -1;
+#endif
+
+    bool map();
+    void unmap();
+};
@@ -0,0 +1,68 @@
+#include "Text.h"
+#include "Trace.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <cstring>
+
+void reserve_text(TextBatch& batch, int glyph_count)
+{
+    // six vertices a glyph, two floats each
+    batch.vertices.reserve((size_t)glyph_count * 12);
+    batch.texture_coordinates.reserve((size_t)glyph_count * 12);
+}
+
+void build_text(TextBatch& batch, const char* text, float font_size, float spacing, glm::vec3 position)
+{
+    TRACE_ZONE("draw_text");
+    // Scale the size of the fontbank in the UV-plane
+    // We will use this for spacing and positioning
+    float width = 1.0f / FONTBANK_COLS;
+    float height = 1.0f / FONTBANK_ROWS;
+
+    // Instead of having a single pair of arrays, we'll have a series of pairs—one for
+    // each character. Don't forget to include <vector>!
+    std::vector<float>& vertices = batch.vertices;
+    std::vector<float>& texture_coordinates = batch.texture_coordinates;
+    vertices.clear();
+    texture_coordinates.clear();
+
+    size_t text_length = strlen(text);
+
+    // For every character...
+    for (size_t i = 0; i < text_length; i++) {
+        // 1. Get their index in the spritesheet, as well as their offset (i.e. their
+        //    position relative to the whole sentence)
+        int spritesheet_index = (int)text[i];  // ascii value of character
+        float offset = (font_size + spacing) * i;
+
+        // 2. Using the spritesheet index, we can calculate our U- and V-coordinates
+        float u_coordinate = (float)(spritesheet_index % FONTBANK_COLS) / FONTBANK_COLS;
+        float v_coordinate = (float)(spritesheet_index / FONTBANK_COLS) / FONTBANK_ROWS;
+
+        // 3. Inset the current pair in both vectors
+        vertices.insert(vertices.end(), {
+            offset + (-0.5f * font_size), 0.5f * font_size,
+            offset + (-0.5f * font_size), -0.5f * font_size,
+            offset + (0.5f * font_size), 0.5f * font_size,
+            offset + (0.5f * font_size), -0.5f * font_size,
+            offset + (0.5f * font_size), 0.5f * font_size,
+            offset + (-0.5f * font_size), -0.5f * font_size,
+            });
+
+        texture_coordinates.insert(texture_coordinates.end(), {
+            u_coordinate, v_coordinate,
+            u_coordinate, v_coordinate + height,
+            u_coordinate + width, v_coordinate,
+            u_coordinate + width, v_coordinate + height,
+            u_coordinate + width, v_coordinate,
+            u_coordinate, v_coordinate + height,
+            });
+    }
+
+    batch.model_matrix = glm::mat4(1.0f);
+    batch.model_matrix = glm::translate(batch.model_matrix, position);
+    // custom scale to preserve original dimensions
+    batch.model_matrix = glm::scale(batch.model_matrix, glm::vec3(0.5f, 1.0f, 1.0f));
+    batch.vertex_count = (int)(text_length * 6);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "glm/mat4x4.hpp"
+
+#include <vector>
+
+// ----- TEXT ----- //
+// Text comes out of the Atari font sheet, a grid of glyphs in ascii order.
+// Building a line is pure CPU work so it can happen off the GL thread; drawing
+// the finished batch is left to the caller.
+
+constexpr int FONTBANK_ROWS = 8;
+constexpr int FONTBANK_COLS = 16;
+
+// one line of text worked out on the CPU, so it can be built off the GL thread.
+// The vectors keep their capacity between frames so rebuilding never allocates
+struct TextBatch
+{
+    std::vector<float> vertices;
+    std::vector<float> texture_coordinates;
+    glm::mat4          model_matrix;
+    int                vertex_count;
+};
+
+void build_text(TextBatch& batch, const char* text, float font_size, float spacing, glm::vec3 position);
+// sizes the batch up front for lines of up to glyph_count characters, so the
+// first long line it gets doesn't allocate mid-game
+void reserve_text(TextBatch& batch, int glyph_count);
@@ -0,0 +1,82 @@
+#include "TextureEncoding.h"
+
+#include <cstring>
+
+size_t texture_data_size(TextureFormat format, int width, int height)
+{
+    return (size_t)texture_storage_width(format, width) * height * (format == TEXTURE_RGBA8 ? 4 : 1);
+}
+
+int texture_storage_width(TextureFormat format, int width)
+{
+    // a mask row is packed eight pixels to the byte
+    return format == TEXTURE_MASK1 ? (width + 7) / 8 : width;
+}
+
+// index of the colour in the palette, adding it if there is room, -1 if full
+static int find_or_add_colour(EncodedTexture& out, const unsigned char* colour)
+{
+    for (int i = 0; i < out.palette_size; i++)
+    {
+        if (memcmp(out.palette[i], colour, 4) == 0) return i;
+    }
+    if (out.palette_size == MAX_PALETTE_COLOURS) return -1;
+
+    memcpy(out.palette[out.palette_size], colour, 4);
+    return out.palette_size++;
+}
+
+void encode_texture(const unsigned char* rgba, int width, int height, bool allow_low_colour,
+    EncodedTexture& out)
+{
+    out.width = width;
+    out.height = height;
+    out.palette_size = 0;
+
+    size_t pixel_count = (size_t)width * height;
+
+    // build the palette, bailing out to RGBA as soon as it overflows
+    bool fits_palette = allow_low_colour;
+    for (size_t i = 0; fits_palette && i < pixel_count; i++)
+    {
+        fits_palette = find_or_add_colour(out, rgba + i * 4) >= 0;
+    }
+
+    if (!fits_palette)
+    {
+        out.format = TEXTURE_RGBA8;
+        out.palette_size = 0;
+        out.pixels.assign(rgba, rgba + pixel_count * 4);
+        return;
+    }
+
+    out.format = out.palette_size <= 2 ? TEXTURE_MASK1 : TEXTURE_INDEXED8;
+    out.pixels.assign(texture_data_size(out.format, width, height), 0);
+
+    if (out.format == TEXTURE_MASK1)
+    {
+        // single colour images still get two entries so the shader can index 0 and 1
+        if (out.palette_size == 1) memcpy(out.palette[1], out.palette[0], 4);
+        out.palette_size = 2;
+
+        int row_bytes = texture_storage_width(TEXTURE_MASK1, width);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                // least significant bit is the leftmost pixel
+                if (memcmp(rgba + ((size_t)y * width + x) * 4, out.palette[1], 4) == 0 &&
+                    memcmp(out.palette[0], out.palette[1], 4) != 0)
+                {
+                    out.pixels[(size_t)y * row_bytes + x / 8] |= (unsigned char)(1 << (x % 8));
+                }
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+        out.pixels[i] = (unsigned char)find_or_add_colour(out, rgba + i * 4);
+    }
+}
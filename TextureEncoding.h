@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// ----- LOW COLOUR TEXTURES ----- //
+// The sprites are ASCII art, so almost every image is just transparent plus one
+// ink colour. Those get stored as a palette plus 8-bit indices, or as a 1-bit
+// mask with eight pixels per byte, and fragment_textured.glsl expands them
+// back out with the palette uniform. Nothing in here touches GL so the asset
+// packer can share it.
+
+enum TextureFormat { TEXTURE_RGBA8, TEXTURE_INDEXED8, TEXTURE_MASK1 };
+
+// both renderers take this, the low colour formats only work with NEAREST
+enum FilterType { NEAREST, LINEAR };
+
+constexpr int MAX_PALETTE_COLOURS = 16; // size of the palette uniform array
+
+// how the pixels are stored, everything needed to upload and draw them
+struct TextureLayout
+{
+    TextureFormat format;
+    int           width;
+    int           height;
+    int           palette_size;
+    unsigned char palette[MAX_PALETTE_COLOURS][4];   // RGBA
+};
+
+struct EncodedTexture : TextureLayout
+{
+    std::vector<unsigned char> pixels;
+};
+
+// picks the smallest format that represents the image exactly; pass
+// allow_low_colour = false to always get RGBA (e.g. for LINEAR filtering)
+void encode_texture(const unsigned char* rgba, int width, int height, bool allow_low_colour,
+    EncodedTexture& out);
+
+// bytes of pixel data for one image in the given format
+size_t texture_data_size(TextureFormat format, int width, int height);
+// width in texels of the GL texture that holds the data
+int    texture_storage_width(TextureFormat format, int width);
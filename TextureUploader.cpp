@@ -0,0 +1,287 @@
+#define GL_SILENCE_DEPRECATION
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <SDL.h>
+#include "TextureUploader.h"
+#include "Trace.h"
+#include "stb_image.h"
+
+#include <cstring>
+
+void TextureUploader::start(ShaderProgram* program, int pixel_buffer_count, int worker_count)
+{
+    m_program = program;
+
+    // fences and immutable storage are nice to have, orphaning the buffer on
+    // every map keeps reuse safe without them
+    m_has_sync = SDL_GL_ExtensionSupported("GL_ARB_sync");
+    m_has_texture_storage = SDL_GL_ExtensionSupported("GL_ARB_texture_storage");
+    m_has_map_range = SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range");
+
+    m_pixel_buffers.assign(pixel_buffer_count, PixelBuffer{ 0, nullptr, nullptr, nullptr });
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        glGenBuffers(1, &m_pixel_buffers[i].id);
+    }
+
+    m_stopping = false;
+    for (int i = 0; i < worker_count; i++)
+    {
+        m_workers.emplace_back(&TextureUploader::worker, this);
+    }
+}
+
+void TextureUploader::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_task_ready.notify_all();
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+    m_workers.clear();
+
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        PixelBuffer& buffer = m_pixel_buffers[i];
+        if (buffer.mapped != nullptr)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        if (buffer.fence != nullptr) glDeleteSync(buffer.fence);
+        glDeleteBuffers(1, &buffer.id);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_pixel_buffers.clear();
+
+    m_jobs.clear();
+    m_incoming.clear();
+    m_tasks.clear();
+    m_queue_depth = 0;
+    m_bytes_in_flight = 0;
+}
+
+// ----- REQUESTS ----- //
+void TextureUploader::request(const char* filepath, UploadCallback on_complete)
+{
+    std::unique_ptr<UploadJob> job(new UploadJob());
+    job->filepath = filepath;
+    job->on_complete = on_complete;
+    job->state = JOB_DECODING;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(job.get());
+    m_incoming.push_back(std::move(job));
+    m_queue_depth++;
+    m_task_ready.notify_one();
+}
+
+void TextureUploader::push_task(UploadJob* job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(job);
+    }
+    m_task_ready.notify_one();
+}
+
+// ----- WORKERS ----- //
+void TextureUploader::worker()
+{
+    TRACE_THREAD_NAME("texture upload");
+    while (true)
+    {
+        UploadJob* job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_task_ready.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping) return;
+
+            job = m_tasks.front();
+            m_tasks.pop_front();
+        }
+
+        if (job->state.load(std::memory_order_acquire) == JOB_DECODING)
+        {
+            TRACE_ZONE("decode texture");
+            int width, height, number_of_components;
+            unsigned char* pixels = stbi_load(job->filepath.c_str(), &width, &height,
+                &number_of_components, STBI_rgb_alpha);
+            if (pixels == NULL)
+            {
+                job->state.store(JOB_FAILED, std::memory_order_release);
+                continue;
+            }
+
+            encode_texture(pixels, width, height, true, job->texture);
+            stbi_image_free(pixels);
+            job->size = job->texture.pixels.size();
+            job->state.store(JOB_DECODED, std::memory_order_release);
+        }
+        else
+        {
+            // JOB_COPYING, the GL thread has mapped a buffer for us
+            memcpy(job->destination, job->texture.pixels.data(), job->size);
+            std::vector<unsigned char>().swap(job->texture.pixels);
+            job->state.store(JOB_WRITTEN, std::memory_order_release);
+        }
+    }
+}
+
+// ----- GL THREAD ----- //
+void TextureUploader::submit(UploadJob* job, PixelBuffer& buffer)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    buffer.mapped = nullptr;
+
+    const TextureLayout& layout = job->texture;
+    bool low_colour = layout.format != TEXTURE_RGBA8;
+    int storage_width = texture_storage_width(layout.format, layout.width);
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    if (m_has_texture_storage)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, 1, low_colour ? GL_ALPHA8 : GL_RGBA8, storage_width, layout.height);
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, low_colour ? GL_ALPHA : GL_RGBA, storage_width, layout.height, 0,
+            low_colour ? GL_ALPHA : GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    // with a PBO bound the pointer is an offset into the buffer
+    glPixelStorei(GL_UNPACK_ALIGNMENT, low_colour ? 1 : 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, storage_width, layout.height,
+        low_colour ? GL_ALPHA : GL_RGBA, GL_UNSIGNED_BYTE, (const void*)0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // everything is drawn NEAREST, low colour textures need it anyway
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    if (m_has_sync) buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_program->register_texture(texture_id, layout);
+    job->texture_id = texture_id;
+    job->state.store(JOB_UPLOADING, std::memory_order_relaxed);
+}
+
+bool TextureUploader::retire(PixelBuffer& buffer)
+{
+    if (buffer.fence != nullptr)
+    {
+        // zero timeout, just asking
+        GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+
+    UploadJob* job = buffer.job;
+    buffer.job = nullptr;
+    m_bytes_in_flight -= job->size;
+
+    if (job->on_complete) job->on_complete(job->texture_id, job->texture);
+    return true;
+}
+
+void TextureUploader::pump()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (!m_incoming.empty())
+        {
+            m_jobs.push_back(std::move(m_incoming.front()));
+            m_incoming.pop_front();
+        }
+    }
+    if (m_jobs.empty()) return;
+
+    for (size_t i = 0; i < m_pixel_buffers.size(); i++)
+    {
+        PixelBuffer& buffer = m_pixel_buffers[i];
+        if (buffer.job == nullptr) continue;
+
+        JobState state = buffer.job->state.load(std::memory_order_acquire);
+        if (state == JOB_WRITTEN) submit(buffer.job, buffer);
+        else if (state == JOB_UPLOADING) retire(buffer);
+    }
+
+    for (size_t i = m_jobs.size(); i > 0; i--)
+    {
+        UploadJob* job = m_jobs[i - 1].get();
+        JobState state = job->state.load(std::memory_order_acquire);
+
+        if (state == JOB_FAILED)
+        {
+            if (job->map_failures > 0) LOG("Couldn't map a pixel buffer to upload " << job->filepath);
+            else LOG("Unable to load image " << job->filepath << ". Make sure the path is correct.");
+            if (job->on_complete) job->on_complete(0, job->texture);
+        }
+        else if (state == JOB_UPLOADING)
+        {
+            // still owned by a buffer until its fence signals
+            bool retired = true;
+            for (size_t b = 0; b < m_pixel_buffers.size(); b++)
+            {
+                if (m_pixel_buffers[b].job == job) retired = false;
+            }
+            if (!retired) continue;
+        }
+        else
+        {
+            continue;
+        }
+
+        m_jobs.erase(m_jobs.begin() + (i - 1));
+        m_queue_depth--;
+    }
+
+    // hand free buffers to whatever finished decoding, oldest first
+    for (size_t i = 0; i < m_jobs.size(); i++)
+    {
+        UploadJob* job = m_jobs[i].get();
+        if (job->state.load(std::memory_order_acquire) != JOB_DECODED) continue;
+
+        PixelBuffer* buffer = nullptr;
+        for (size_t b = 0; b < m_pixel_buffers.size() && buffer == nullptr; b++)
+        {
+            if (m_pixel_buffers[b].job == nullptr) buffer = &m_pixel_buffers[b];
+        }
+        if (buffer == nullptr) break;
+
+        // respecifying the store orphans whatever the GPU might still be reading
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->id);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, job->size, NULL, GL_STREAM_DRAW);
+        buffer->mapped = m_has_map_range
+            ? glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, job->size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)
+            : glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        // out of memory or a lost context, the buffer stays free and the job
+        // waits for the next pump (or fails) instead of a worker copying to NULL
+        if (buffer->mapped == nullptr)
+        {
+            if (++job->map_failures == MAX_MAP_FAILURES) job->state.store(JOB_FAILED, std::memory_order_relaxed);
+            break;
+        }
+
+        buffer->job = job;
+        m_bytes_in_flight += job->size;
+
+        job->destination = buffer->mapped;
+        job->state.store(JOB_COPYING, std::memory_order_release);
+        push_task(job);
+    }
+}
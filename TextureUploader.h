@@ -0,0 +1,97 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShaderProgram.h"
+#include "TextureEncoding.h"
+
+// Streams textures onto the GPU without stalling the frame.
+//
+//   worker:    decode the PNG and shrink it (TextureEncoding)
+//   GL thread: map a free pixel buffer object
+//   worker:    copy the pixels into the mapping
+//   GL thread: unmap, glTexSubImage2D from the PBO, drop a fence
+//   GL thread: once the fence signals, free the PBO and run the callback
+//
+// The GL thread side only ever happens inside pump(), which never waits on
+// anything, so calling it once a frame is enough.
+class TextureUploader
+{
+public:
+    typedef std::function<void(GLuint texture_id, const TextureLayout& layout)> UploadCallback;
+
+    void start(ShaderProgram* program, int pixel_buffer_count, int worker_count);
+    void shutdown();
+
+    // any thread; the callback runs on the GL thread inside pump()
+    void request(const char* filepath, UploadCallback on_complete);
+
+    // GL thread only
+    void pump();
+
+    int    const get_queue_depth()     const { return m_queue_depth.load(std::memory_order_relaxed); }
+    size_t const get_bytes_in_flight() const { return m_bytes_in_flight.load(std::memory_order_relaxed); }
+
+private:
+    enum JobState { JOB_DECODING, JOB_DECODED, JOB_COPYING, JOB_WRITTEN, JOB_UPLOADING, JOB_FAILED };
+
+    // a job whose buffer won't map gets retried on the next few pumps, then given up on
+    static constexpr int MAX_MAP_FAILURES = 3;
+
+    struct UploadJob
+    {
+        std::string           filepath;
+        EncodedTexture        texture;
+        size_t                size;
+        UploadCallback        on_complete;
+        std::atomic<JobState> state;
+        void*                 destination; // the mapped PBO while JOB_COPYING
+        GLuint                texture_id;  // set once JOB_UPLOADING
+        int                   map_failures;
+    };
+
+    struct PixelBuffer
+    {
+        GLuint     id;
+        void*      mapped;
+        GLsync     fence;
+        UploadJob* job;
+    };
+
+    ShaderProgram* m_program = nullptr;
+    bool           m_has_sync = false;
+    bool           m_has_texture_storage = false;
+    bool           m_has_map_range = false;
+
+    std::vector<PixelBuffer>                m_pixel_buffers;
+    std::vector<std::unique_ptr<UploadJob>> m_jobs;          // GL thread only
+    std::deque<std::unique_ptr<UploadJob>>  m_incoming;      // guarded by m_mutex
+
+    std::vector<std::thread> m_workers;
+    std::deque<UploadJob*>   m_tasks;                       // guarded by m_mutex
+    std::mutex               m_mutex;
+    std::condition_variable  m_task_ready;
+    bool                     m_stopping = false;
+
+    std::atomic<int>    m_queue_depth{ 0 };
+    std::atomic<size_t> m_bytes_in_flight{ 0 };
+
+    void worker();
+    void push_task(UploadJob* job);
+    void submit(UploadJob* job, PixelBuffer& buffer);
+    bool retire(PixelBuffer& buffer);
+};
@@ -0,0 +1,127 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char* name;
+        uint64_t    start;
+        uint64_t    end;
+    };
+
+    // Written only by its own thread. Readers copy the events out and then
+    // throw away anything the writer may have lapped while they were copying
+    struct ThreadRing
+    {
+        TraceEvent               events[Trace::RING_CAPACITY];
+        std::atomic<uint64_t>    written{ 0 };
+        std::atomic<const char*> name{ "thread" };
+        int                      id;
+    };
+
+    std::mutex               g_rings_mutex;
+    std::vector<ThreadRing*> g_rings;         // never freed, a thread's zones outlive it
+    thread_local ThreadRing* t_ring = nullptr;
+
+    std::chrono::steady_clock::time_point const& epoch()
+    {
+        static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+        return s_epoch;
+    }
+
+    ThreadRing* get_ring()
+    {
+        if (t_ring == nullptr)
+        {
+            // first zone on this thread, the only time recording allocates
+            ThreadRing* ring = new ThreadRing();
+            std::lock_guard<std::mutex> lock(g_rings_mutex);
+            ring->id = (int)g_rings.size() + 1;
+            g_rings.push_back(ring);
+            t_ring = ring;
+        }
+        return t_ring;
+    }
+}
+
+void Trace::set_thread_name(const char* name)
+{
+    get_ring()->name.store(name, std::memory_order_relaxed);
+}
+
+uint64_t Trace::now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch()).count();
+}
+
+void Trace::record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadRing* ring = get_ring();
+    uint64_t index = ring->written.load(std::memory_order_relaxed);
+
+    TraceEvent& event = ring->events[index & (RING_CAPACITY - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    ring->written.store(index + 1, std::memory_order_release);
+}
+
+int Trace::write_chrome_json(const char* filepath)
+{
+    FILE* file = fopen(filepath, "w");
+    if (file == NULL) return -1;
+
+    std::vector<ThreadRing*> rings;
+    {
+        std::lock_guard<std::mutex> lock(g_rings_mutex);
+        rings = g_rings;
+    }
+
+    std::vector<TraceEvent> events(RING_CAPACITY);
+    int zone_count = 0;
+    bool first = true;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t r = 0; r < rings.size(); r++)
+    {
+        ThreadRing* ring = rings[r];
+
+        uint64_t end = ring->written.load(std::memory_order_acquire);
+        uint64_t copy_begin = end > RING_CAPACITY ? end - RING_CAPACITY : 0;
+        for (uint64_t i = copy_begin; i < end; i++)
+        {
+            events[i - copy_begin] = ring->events[i & (RING_CAPACITY - 1)];
+        }
+
+        // anything below here may have been overwritten mid copy, counting the
+        // slot the writer could be filling right now
+        uint64_t written_now = ring->written.load(std::memory_order_acquire) + 1;
+        uint64_t safe_begin = written_now > RING_CAPACITY ? written_now - RING_CAPACITY : 0;
+        uint64_t begin = std::min(std::max(copy_begin, safe_begin), end);
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",\n", ring->id, ring->name.load(std::memory_order_relaxed));
+        first = false;
+
+        for (uint64_t i = begin; i < end; i++)
+        {
+            const TraceEvent& event = events[i - copy_begin];
+            // complete events, microseconds
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                event.name, ring->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+            zone_count++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    return zone_count;
+}
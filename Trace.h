@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Scoped timing zones. TRACE_ZONE("name") times the rest of the enclosing block
+// into a ring buffer owned by the calling thread, so recording never takes a
+// lock or allocates (past each thread's first zone). Trace::write_chrome_json()
+// dumps whatever the rings still hold in the format chrome://tracing and
+// ui.perfetto.dev open.
+//
+// Zones are compiled in by default so a trace can be grabbed from any build;
+// define DISABLE_TRACING to compile every TRACE_ macro away to nothing.
+// Names have to outlive the trace, string literals are the easy way.
+
+class Trace
+{
+public:
+    static constexpr size_t RING_CAPACITY = 1 << 14; // zones kept per thread, power of two
+
+    // shows up as the thread's name in the trace viewer
+    static void set_thread_name(const char* name);
+
+    // nanoseconds since the first call, the clock every zone uses
+    static uint64_t now();
+    static void record(const char* name, uint64_t start, uint64_t end);
+
+    // safe to call while other threads keep recording. Returns how many zones
+    // were written, -1 if the file couldn't be opened
+    static int write_chrome_json(const char* filepath);
+};
+
+class TraceZone
+{
+private:
+    const char* m_name;
+    uint64_t    m_start;
+
+public:
+    TraceZone(const char* name) : m_name(name), m_start(Trace::now()) {}
+    ~TraceZone() { Trace::record(m_name, m_start, Trace::now()); }
+};
+
+#ifndef DISABLE_TRACING
+    #define TRACE_CONCAT_INNER(a, b) a##b
+    #define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+    #define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+    #define TRACE_THREAD_NAME(name) Trace::set_thread_name(name)
+#else
+    #define TRACE_ZONE(name)
+    #define TRACE_THREAD_NAME(name)
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+
+// Hands the newest copy of T from one writer thread to one reader thread
+// without either ever waiting on the other.
+//
+// There are three slots: the writer fills its back slot, the reader looks at
+// its front slot, and the one in the middle is swapped with whichever side
+// finishes next. The writer can publish as often as it likes, the reader just
+// skips the states it never got around to picking up.
+template <typename T>
+class TripleBuffer
+{
+private:
+    static constexpr int INDEX_MASK = 3;
+    static constexpr int FRESH_BIT = 4;   // middle holds something the reader hasn't seen
+
+    T                m_slots[3] = {};
+    std::atomic<int> m_middle{ 1 };
+    int              m_back = 0;           // writer only
+    int              m_front = 2;          // reader only
+
+public:
+    // writer: fill this in, then publish()
+    T& get_back() { return m_slots[m_back]; }
+
+    void publish()
+    {
+        int old_middle = m_middle.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel);
+        m_back = old_middle & INDEX_MASK;
+    }
+
+    // reader: swaps in the newest published state, false if nothing new came in
+    bool update_front()
+    {
+        if ((m_middle.load(std::memory_order_acquire) & FRESH_BIT) == 0) return false;
+
+        int old_middle = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = old_middle & INDEX_MASK;
+        return true;
+    }
+
+    T const& get_front() const { return m_slots[m_front]; }
+};
@@ -25,9 +25,33 @@
 #include "ShaderProgram.h"
 #include "stb_image.h"
 #include "cmath"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
 #include <ctime>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "Entity.h"
+#include "AllocTracker.h"
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "TextureEncoding.h"
+#include "TextureUploader.h"
+#include "Frame.h"
+#include "FrameCapture.h"
+#include "BinaryLog.h"
+#include "Telemetry.h"
+#include "FramePacer.h"
+#include "Input.h"
+#include "TaskGraph.h"
+#include "PerfOverlay.h"
+#include "Replay.h"
+#include "Text.h"
+#include "Trace.h"
+#include "Simulation.h"
+#include "TripleBuffer.h"
 
 
 // ----- SOURCES ----- //
@@ -59,6 +83,7 @@ constexpr char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
 F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
 
 constexpr float MILLISECONDS_IN_SECOND = 1000.0;
+constexpr int DEFAULT_MAX_STEPS_PER_FRAME = 5;   // --max-steps overrides
 
 constexpr GLint NUMBER_OF_TEXTURES = 1,
 LEVEL_OF_DETAIL = 0,
@@ -67,59 +92,180 @@ TEXTURE_BORDER = 0;
 
 // ----- OBJECT CONSTANTS ----- //
 GLuint g_font_texture_id;
-GLuint g_bubble_texture_id;
-constexpr char SHIP_FILEPATH[] = "assets/bottle_ship_flip.png"; // 208 x 96 13:6
-constexpr char FONTSHEET_FILEPATH[] = "assets/modified_atari_font.png"; // 256 x 256 
-constexpr char PLATFORM1_FILEPATH[] = "assets/castle.png"; // 256 x 128 
-constexpr char SHARK_FILEPATH[] = "assets/shark.png"; // 424 x 160 53: 20
-constexpr char TOWER_FILEPATH[] = "assets/tower.png"; // 96 x 128 3:4
-constexpr char BUBBLE_FILEPATH[] = "assets/bubble2.png"; // 16 x 16
+
+// raw pixels for every texture, built by tools/pack_assets.cpp. If it is missing,
+// broken or older than any of the PNGs the PNGs get decoded instead
+constexpr char ASSET_PACK_FILEPATH[] = "assets/assets.pack";
+
+// where F2 dumps the trace zones, open it in chrome://tracing or ui.perfetto.dev
+constexpr char TRACE_FILEPATH[] = "trace.json";
+
+// where F3 starts recording frames if --capture didn't name somewhere
+constexpr char CAPTURE_DIRECTORY[] = "capture";
 
 // ----- STRUCTS AND ENUMS ----- //
 enum AppStatus { RUNNING, TERMINATED };
-enum FilterType {NEAREST, LINEAR }; // trying to fix the glitchy rendering but whatever
 
-struct GameState
+// a startup texture's PNG as it was last loaded, F5 reloads the ones that changed
+struct TextureSource
 {
-    Entity* ship;
-    Entity* platforms;
-    std::vector<Entity*> bubbles;
+    uint64_t size;
+    int64_t  modified;
+    GLuint   reloaded_id;       // bound in place of the startup texture, 0 until reloaded
+};
+
+struct SimStats
+{
+    Uint64 frames;
+    Uint64 steps;
+    Uint64 caught_up_steps;     // steps beyond the first in a frame
+    Uint64 dropped_steps;       // skipped because the frame hit the step cap
+    int    last_frame_steps;
+};
+
+// key press to the end of the first buffer swap that shows it
+struct LatencyStats
+{
+    unsigned pending_sequence;  // press being timed, 0 when there isn't one
+    Uint64   pending_counter;
+    Uint64   samples;
+    float    total_ms;
+    float    worst_ms;
 };
 
 // ----- GAME CONSTANTS ----- //
-constexpr int FONTBANK_ROWS = 8;
-constexpr int FONTBANK_COLS = 16;
-constexpr int NUM_PLATFORMS = 3;
+constexpr int ALLOC_WARMUP_FRAMES = 120; // frames before strict allocation checks kick in
+constexpr int UPLOAD_PIXEL_BUFFERS = 2;  // textures that can be mid-upload at once
+constexpr int UPLOAD_WORKERS = 1;
+constexpr int CAPTURE_PIXEL_BUFFERS = 4; // frames that can be mid-readback at once
+constexpr int CAPTURE_WORKERS = 2;       // PNG encoding, one can't quite keep up at 60 fps
+constexpr int IDLE_WAIT_MILLISECONDS = 250; // longest a static screen sleeps before checking again
+constexpr int DEFAULT_TASK_WORKERS = 1;  // per graph, on top of the thread running it
+
+// what the frame tasks build for submit_frame() to draw
+struct FrameBatches
+{
+    const GameSnapshot* snapshot;
+    float               alpha;
+    FrameData           data;           // HUD, messages and sprites, see Frame.h
+    TextBatch           overlay[PerfOverlay::MAX_LINES];
+    int                 overlay_count;
+};
 
 // ----- VARIABLES ----- //
 GameState g_game_state;
+InitialState g_initial_state;
 
 SDL_Window* g_display_window;
 AppStatus g_app_status = RUNNING;
-AngleDirection g_angle_dir = NONE;
-bool g_using_fuel = false;
+InputQueue g_input_queue;           // main thread in, stepping thread out
+InputLatch g_input_latch;           // stepping thread only
+unsigned g_input_sequence = 0;      // last InputEvent::sequence queued
+LatencyStats g_latency = {};
 
 ShaderProgram g_shader_program;
+GLFrameRenderer g_renderer(&g_shader_program);
+TextureUploader g_texture_uploader;    // for art streamed in after startup
+FrameCapture g_frame_capture;
+const char* g_capture_directory = NULL;
+CaptureFormat g_capture_format = CAPTURE_PNG;
+FramePacer g_frame_pacer;
+PacingMode g_pacing_mode = PACING_VSYNC;
+int g_target_fps = FramePacer::DEFAULT_TARGET_FPS;
 glm::mat4 g_view_matrix, g_projection_matrix;
 
-float g_previous_ticks = 0.0f;
-float g_accumulator = 0.0f;
+// seconds per simulation step, the display rate is separate thanks to interpolation
+float g_fixed_timestep = FIXED_TIMESTEP;
+
+// all in SDL performance counter ticks
+Uint64 g_previous_counter = 0;
+Uint64 g_accumulator = 0;
+Uint64 g_step_ticks = 0;
+
+int g_max_steps_per_frame = DEFAULT_MAX_STEPS_PER_FRAME;
+SimStats g_sim_stats = {};          // owned by whichever thread steps the simulation
+
+// the simulation steps on its own thread by default (--no-sim-thread to step it
+// from the main loop instead). Either way render only ever reads g_snapshots
+bool g_threaded_simulation = true;
+std::thread g_simulation_thread;
+std::atomic<bool> g_simulation_running{ false };
+std::mutex g_simulation_idle_mutex;
+std::condition_variable g_simulation_wake;  // a key was queued or it's time to stop
+TripleBuffer<GameSnapshot> g_snapshots;
+unsigned g_applied_sequence = 0;    // stepping thread only
+ReplayRecorder g_replay_recorder;   // stepping thread only, once --record has opened it
+const char* g_record_filepath = NULL;
+const char* g_log_filepath = NULL;    // --log FILE, "-" formats to stdout instead
+TelemetryWriter g_telemetry;        // stepping thread only, once --telemetry has opened it
+const char* g_telemetry_filepath = NULL;
+uint32_t g_telemetry_run = 0;       // bumped by every restart
+
+// each step and each frame run as a small task graph so independent work
+// overlaps, see build_step_graph() and build_frame_graph()
+TaskGraph g_step_graph;
+TaskGraph g_frame_graph;
+int g_task_workers = DEFAULT_TASK_WORKERS;
+SimInput g_step_input;              // for the step g_step_graph is running
+FrameBatches g_frame;
+
+// F1 overlay and what it's fed each frame
+PerfOverlay g_overlay;
+Uint64 g_last_frame_counter = 0;
+uint64_t g_last_frame_step_total = 0;
+int g_last_draw_calls = 0;
+
+int g_steady_frames = 0;
+const char* g_trace_on_exit = NULL;  // --trace FILE
+
+// nothing moves outside ACTIVE, so those screens only redraw when something happens
+bool g_needs_redraw = true;
+EntityStatus g_rendered_status = START;
+
+GLuint g_texture_ids[NUM_TEXTURE_ASSETS];   // what the entities were built with
+TextureSource g_texture_sources[NUM_TEXTURE_ASSETS];
+
+// texture memory actually uploaded versus what plain RGBA would have cost
+size_t g_uploaded_texture_bytes = 0;
+size_t g_rgba_texture_bytes = 0;
 
 void initialise();
 void process_input();
 void update();
+void simulation_thread();
+void build_step_graph();
+void build_frame_graph();
 void render();
 void shutdown();
 
-GLuint load_texture(const char* filepath);
+GLuint load_texture(const char* filepath, FilterType filterType);
+GLuint upload_texture(const unsigned char* image, const TextureLayout& layout, FilterType filterType);
 
 // ---- GENERAL FUNCTIONS ---- //
+float elapsed_ms(Uint64 start_counter)
+{
+    return (float)(SDL_GetPerformanceCounter() - start_counter) * MILLISECONDS_IN_SECOND
+        / (float)SDL_GetPerformanceFrequency();
+}
+
 GLuint load_texture(const char* filepath, FilterType filterType)
 {
     int width, height, number_of_components;
     unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components,
         STBI_rgb_alpha);
 
+    TextureLayout layout = { TEXTURE_RGBA8, width, height, 0 };
+    GLuint textureID = upload_texture(image, layout, filterType);
+    stbi_image_free(image);
+
+    return textureID;
+}
+
+// GL half of load_texture, for pixels that were already decoded elsewhere.
+// Low colour layouts go up as one byte per texel (indices, or eight mask bits)
+// and get expanded again by the fragment shader, which only works with NEAREST.
+GLuint upload_texture(const unsigned char* image, const TextureLayout& layout, FilterType filterType)
+{
     if (image == NULL)
     {
         LOG("Unable to load image. Make sure the path is correct.");
@@ -129,8 +275,23 @@ GLuint load_texture(const char* filepath, FilterType filterType)
     GLuint textureID;
     glGenTextures(NUMBER_OF_TEXTURES, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER,
-        GL_RGBA, GL_UNSIGNED_BYTE, image);
+    if (layout.format == TEXTURE_RGBA8)
+    {
+        glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, layout.width, layout.height, TEXTURE_BORDER,
+            GL_RGBA, GL_UNSIGNED_BYTE, image);
+    }
+    else
+    {
+        assert(filterType == NEAREST);
+        // rows of packed bytes are not 4-byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_ALPHA, texture_storage_width(layout.format, layout.width),
+            layout.height, TEXTURE_BORDER, GL_ALPHA, GL_UNSIGNED_BYTE, image);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    g_shader_program.register_texture(textureID, layout);
+    g_uploaded_texture_bytes += texture_data_size(layout.format, layout.width, layout.height);
+    g_rgba_texture_bytes += texture_data_size(TEXTURE_RGBA8, layout.width, layout.height);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
         filterType == NEAREST ? GL_NEAREST : GL_LINEAR);
@@ -140,82 +301,49 @@ GLuint load_texture(const char* filepath, FilterType filterType)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-    stbi_image_free(image);
-
     return textureID;
 }
 
-void draw_text(ShaderProgram* shader_program, GLuint font_texture_id, std::string text,
-    float font_size, float spacing, glm::vec3 position)
-{
-    // Scale the size of the fontbank in the UV-plane
-    // We will use this for spacing and positioning
-    float width = 1.0f / FONTBANK_COLS;
-    float height = 1.0f / FONTBANK_ROWS;
-
-    // Instead of having a single pair of arrays, we'll have a series of pairs—one for
-    // each character. Don't forget to include <vector>!
-    std::vector<float> vertices;
-    std::vector<float> texture_coordinates;
-
-    // For every character...
-    for (size_t i = 0; i < text.size(); i++) {
-        // 1. Get their index in the spritesheet, as well as their offset (i.e. their
-        //    position relative to the whole sentence)
-        int spritesheet_index = (int)text[i];  // ascii value of character
-        float offset = (font_size + spacing) * i;
-
-        // 2. Using the spritesheet index, we can calculate our U- and V-coordinates
-        float u_coordinate = (float)(spritesheet_index % FONTBANK_COLS) / FONTBANK_COLS;
-        float v_coordinate = (float)(spritesheet_index / FONTBANK_COLS) / FONTBANK_ROWS;
-
-        // 3. Inset the current pair in both vectors
-        vertices.insert(vertices.end(), {
-            offset + (-0.5f * font_size), 0.5f * font_size,
-            offset + (-0.5f * font_size), -0.5f * font_size,
-            offset + (0.5f * font_size), 0.5f * font_size,
-            offset + (0.5f * font_size), -0.5f * font_size,
-            offset + (0.5f * font_size), 0.5f * font_size,
-            offset + (-0.5f * font_size), -0.5f * font_size,
-            });
-
-        texture_coordinates.insert(texture_coordinates.end(), {
-            u_coordinate, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate + width, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            });
-    }
-
-    // 4. And render all of them using the pairs
-    glm::mat4 model_matrix = glm::mat4(1.0f);
-    model_matrix = glm::translate(model_matrix, position);
-    // custom scale to preserve original dimensions
-    model_matrix = glm::scale(model_matrix, glm::vec3(0.5f, 1.0f, 1.0f));
-
-    shader_program->set_model_matrix(model_matrix);
-    glUseProgram(shader_program->get_program_id());
-
-    glVertexAttribPointer(shader_program->get_position_attribute(), 2, GL_FLOAT, false, 0,
-        vertices.data());
-    glEnableVertexAttribArray(shader_program->get_position_attribute());
-
-    glVertexAttribPointer(shader_program->get_tex_coordinate_attribute(), 2, GL_FLOAT,
-        false, 0, texture_coordinates.data());
-    glEnableVertexAttribArray(shader_program->get_tex_coordinate_attribute());
+void start_capture(const char* directory)
+{
+    g_frame_capture.start(directory, g_capture_format, WINDOW_WIDTH, WINDOW_HEIGHT, CAPTURE_PIXEL_BUFFERS, CAPTURE_WORKERS);
+    LOG("Capturing frames to " << directory << "/");
+}
 
-    glBindTexture(GL_TEXTURE_2D, font_texture_id);
-    glDrawArrays(GL_TRIANGLES, 0, (int)(text.size() * 6));
+void stop_capture()
+{
+    if (!g_frame_capture.is_running()) return;
 
-    glDisableVertexAttribArray(shader_program->get_position_attribute());
-    glDisableVertexAttribArray(shader_program->get_tex_coordinate_attribute());
+    g_frame_capture.shutdown();
+    LOG("Captured " << g_frame_capture.get_written() << " frames to " << g_frame_capture.get_directory() << "/, "
+        << g_frame_capture.get_dropped() << " dropped, " << g_frame_capture.get_failed() << " failed, "
+        << g_frame_capture.get_average_encode_ms() << " ms average encode");
 }
 
 
 void initialise()
 {
+    Uint64 startup_counter = SDL_GetPerformanceCounter();
+    Uint64 phase_counter = startup_counter;
+
+    // the pack is only used if it has every texture we need, packed from the PNGs as they are now
+    AssetPack asset_pack;
+    const AssetPackEntry* pack_entries[NUM_TEXTURE_ASSETS] = {};
+    bool use_pack = asset_pack.open(ASSET_PACK_FILEPATH);
+    for (int i = 0; use_pack && i < NUM_TEXTURE_ASSETS; i++)
+    {
+        pack_entries[i] = asset_pack.find(TEXTURE_FILEPATHS[i]);
+        use_pack = pack_entries[i] != nullptr && asset_pack.is_current(pack_entries[i]);
+        if (pack_entries[i] != nullptr && !use_pack)
+        {
+            LOG(TEXTURE_FILEPATHS[i] << " changed since " << ASSET_PACK_FILEPATH << " was built, rerun pack_assets");
+        }
+    }
+
+    // otherwise start decoding the PNGs first so it overlaps with window and shader setup
+    AssetLoader asset_loader;
+    if (!use_pack) asset_loader.start(TEXTURE_FILEPATHS, NUM_TEXTURE_ASSETS);
+
     SDL_Init(SDL_INIT_VIDEO);
     g_display_window = SDL_CreateWindow("Lunar Lander!",
         SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
@@ -235,6 +363,9 @@ void initialise()
     glewInit();
 #endif
 
+    float window_ms = elapsed_ms(phase_counter);
+    phase_counter = SDL_GetPerformanceCounter();
+
     glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
 
     g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH);
@@ -249,77 +380,92 @@ void initialise()
 
     glClearColor(BG_RED, BG_GREEN, BG_BLUE, BG_OPACITY);
 
+    float shader_ms = elapsed_ms(phase_counter);
+    phase_counter = SDL_GetPerformanceCounter();
+
     // TEXTURES 
-    GLuint ship_texture_id = load_texture(SHIP_FILEPATH, NEAREST);
-    GLuint castle_texture_id = load_texture(PLATFORM1_FILEPATH, NEAREST);
-    GLuint shark_texture_id = load_texture(SHARK_FILEPATH, NEAREST);
-    GLuint tower_texture_id = load_texture(TOWER_FILEPATH, NEAREST);
-    g_font_texture_id = load_texture(FONTSHEET_FILEPATH, NEAREST);
-    g_bubble_texture_id = load_texture(BUBBLE_FILEPATH, NEAREST);
+    // only the uploads happen here, the decoding ran on the loader threads
+    asset_loader.wait();
+    float decode_wait_ms = elapsed_ms(phase_counter);
+    phase_counter = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < NUM_TEXTURE_ASSETS; i++)
+    {
+        TextureSource& source = g_texture_sources[i];
+        source = { 0, 0, 0 };
+        get_source_stamp(TEXTURE_FILEPATHS[i], source.size, source.modified);
+
+        if (use_pack)
+        {
+            const AssetPackEntry* entry = pack_entries[i];
+            TextureLayout layout = { (TextureFormat)entry->format, (int)entry->width, (int)entry->height,
+                (int)entry->palette_size };
+            memcpy(layout.palette, entry->palette, sizeof(layout.palette));
+
+            // straight out of the mapping, no intermediate copy
+            g_texture_ids[i] = upload_texture(asset_pack.get_pixels(entry), layout, NEAREST);
+        }
+        else
+        {
+            DecodedImage const& image = asset_loader.get_image(i);
+            g_texture_ids[i] = upload_texture(image.loaded ? image.texture.pixels.data() : NULL,
+                image.texture, NEAREST);
+        }
+    }
+    asset_loader.free_images();
+    asset_pack.close();
+    float upload_ms = elapsed_ms(phase_counter);
+
+    g_font_texture_id = g_texture_ids[FONT_TEXTURE];
+
+    LOG("Startup (" << (use_pack ? "asset pack" : "decoding PNGs") << "): window " << window_ms << " ms, shaders " << shader_ms
+        << " ms, waiting on decode " << decode_wait_ms << " ms, upload " << upload_ms
+        << " ms, total " << elapsed_ms(startup_counter) << " ms");
+    LOG("Textures: " << g_uploaded_texture_bytes << " bytes uploaded, "
+        << g_rgba_texture_bytes << " as RGBA");
+    for (int i = 0; !use_pack && i < NUM_TEXTURE_ASSETS; i++)
+    {
+        LOG("  decoded " << asset_loader.get_image(i).filepath << " in "
+            << asset_loader.get_image(i).decode_ms << " ms");
+    }
 
     // ----- STUFF TO INITIALISE ----- //
 
-    // ----- SHIP ----- //
-    g_game_state.ship = new Entity(
-        ship_texture_id,                    // texture_id
-        0.0f,                               // speed
-        glm::vec3(0.0f, 0.0f, 0.0f),        // acceleration vector
-        true,                               // use acceleration
-        START,                              // EntityStatus
-        false                               // not enemy
-    );
-
-    g_game_state.ship->set_movement(glm::vec3(0.0f, 0.0f, 0.0f));
-    g_game_state.ship->set_scale(glm::vec3(1.0833f, 0.5f, 1.0f));
-    g_game_state.ship->set_position(glm::vec3(-4.4f, 3.5f, 1.0f));
-    g_game_state.ship->set_dimensions(g_game_state.ship->get_scale().x, g_game_state.ship->get_scale().y);
-    g_game_state.ship->update(0.0f, nullptr, 0);
-
-
-    // ----- PLATFORMS ----- //
-    g_game_state.platforms = new Entity[NUM_PLATFORMS];
-
-    // castle
-    g_game_state.platforms[0] = Entity(
-        castle_texture_id,                  // texture id
-        0.0f,                               // speed
-        glm::vec3(0.0f),                    // acceleration
-        false,                              // uses acceleration
-        ACTIVE,                             // EntityStatus
-        false                               // landable platform so not enemy
-    );
-    g_game_state.platforms[0].set_position(glm::vec3(3.9f, -3.20f, 1.0f));
-    g_game_state.platforms[0].set_scale(glm::vec3(2.0f, 1.0f, 1.0f));
-
-    // shark
-    g_game_state.platforms[1] = Entity(
-        shark_texture_id,                   // texture id
-        1.0f,                               // speed
-        glm::vec3(0.0f),                    // acceleration
-        false,                              // uses acceleration
-        ACTIVE,                             // EntityStatus
-        true                                // shark so is enemy 
-    );
-    g_game_state.platforms[1].set_position(glm::vec3(0.0f, 0.0f, 1.0f));
-    g_game_state.platforms[1].set_scale(glm::vec3(2.65f, 1.0f, 1.0f));
-    g_game_state.platforms[1].set_movement(glm::vec3(-0.5f, 0.0f, 0.0f));
-
-    // tower
-    g_game_state.platforms[2] = Entity(
-        tower_texture_id,                   // texture id
-        0.0f,                               // speed
-        glm::vec3(0.0f),                    // acceleration
-        false,                              // uses acceleration
-        ACTIVE,                             // EntityStatus
-        false                               // landable platform so not enemy
-    );
-    g_game_state.platforms[2].set_position(glm::vec3(1.0f, -3.2f, 1.0f));
-    g_game_state.platforms[2].set_scale(glm::vec3(0.75f, 1.0f, 1.0f));
-
-    for (int i = 0; i < NUM_PLATFORMS; i++)
+    build_level(g_game_state, g_initial_state, get_level_textures(g_texture_ids));
+    if (g_telemetry_filepath != NULL &&
+        !g_telemetry.open(g_telemetry_filepath, (int)(1.0f / g_fixed_timestep + 0.5f), *g_game_state.ship,
+            g_game_state.platforms, NUM_PLATFORMS))
+    {
+        LOG("Couldn't open " << g_telemetry_filepath);
+    }
+
+    g_texture_uploader.start(&g_shader_program, UPLOAD_PIXEL_BUFFERS, UPLOAD_WORKERS);
+    if (g_capture_directory != NULL) start_capture(g_capture_directory);
+
+    // ----- TIMING ----- //
+    g_step_ticks = (Uint64)(g_fixed_timestep * SDL_GetPerformanceFrequency() + 0.5);
+    g_previous_counter = SDL_GetPerformanceCounter();
+    g_last_frame_counter = g_previous_counter;
+    g_frame_pacer.start(g_pacing_mode, g_target_fps);
+
+    // something to draw before the first step lands
+    take_snapshot(g_game_state, g_snapshots.get_back());
+    g_snapshots.get_back().command_sequence = 0;
+    g_snapshots.get_back().step_total = 0;
+    g_snapshots.get_back().step_counter = g_previous_counter;
+    g_snapshots.publish();
+
+    reserve_frame(g_frame.data);
+    // the overlay can be turned on at any point and its bars keep growing
+    for (int i = 0; i < PerfOverlay::MAX_LINES; i++) reserve_text(g_frame.overlay[i], PerfOverlay::LINE_LENGTH);
+    build_step_graph();
+    build_frame_graph();
+
+    if (g_threaded_simulation)
     {
-        g_game_state.platforms[i].update(0.0f, nullptr, 0);
-        g_game_state.platforms[i].set_dimensions(g_game_state.platforms[i].get_scale().x, g_game_state.platforms[i].get_scale().y);
+        // from here on only the simulation thread touches g_game_state
+        g_simulation_running = true;
+        g_simulation_thread = std::thread(simulation_thread);
     }
 
     // ----- GENERAL ----- //
@@ -327,193 +473,608 @@ void initialise()
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void process_input()
+// SDL stamps events in milliseconds since init, this puts that on the
+// performance counter clock the simulation steps by
+Uint64 event_counter(Uint32 timestamp)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 age = (Uint64)(SDL_GetTicks() - timestamp) * SDL_GetPerformanceFrequency() / 1000;
+    return age < now ? now - age : now;
+}
+
+// the simulation thread sleeps while nothing can move, see simulation_thread()
+void wake_simulation()
+{
+    if (!g_threaded_simulation) return;
+
+    // taking the lock orders this after the waiter's last look at the queue
+    {
+        std::lock_guard<std::mutex> lock(g_simulation_idle_mutex);
+    }
+    g_simulation_wake.notify_one();
+}
+
+void queue_input(InputKey key, bool pressed, Uint64 counter)
+{
+    InputEvent input_event = { counter, g_input_sequence + 1, key, pressed };
+    if (!g_input_queue.push(input_event))
+    {
+        LOG("Input queue full, dropped a key");
+        return;
+    }
+    g_input_sequence++;
+    wake_simulation();
+
+    // time the oldest press nobody has seen yet, render() finishes the measurement
+    if (pressed && g_latency.pending_sequence == 0)
+    {
+        g_latency.pending_sequence = g_input_sequence;
+        g_latency.pending_counter = counter;
+    }
+}
+
+// GL thread, inside g_texture_uploader.pump()
+void finish_texture_reload(int asset, GLuint texture_id)
+{
+    if (texture_id == 0) return;   // the uploader has said why
+
+    TextureSource& source = g_texture_sources[asset];
+    if (source.reloaded_id != 0) glDeleteTextures(1, &source.reloaded_id);
+    source.reloaded_id = texture_id;
+    g_shader_program.replace_texture(g_texture_ids[asset], texture_id);
+    g_needs_redraw = true;
+    LOG("Reloaded " << TEXTURE_FILEPATHS[asset]);
+}
+
+// streams every texture whose PNG changed since it was loaded back in through
+// the uploader, the old one keeps being drawn until the new one is on the GPU
+void reload_changed_textures()
 {
-    // reset 
-    g_angle_dir = NONE;
-    g_using_fuel = false;
+    int requested = 0;
+    for (int i = 0; i < NUM_TEXTURE_ASSETS; i++)
+    {
+        TextureSource& source = g_texture_sources[i];
+        uint64_t size;
+        int64_t modified;
+        if (!get_source_stamp(TEXTURE_FILEPATHS[i], size, modified)) continue;
+        if (size == source.size && modified == source.modified) continue;
+
+        source.size = size;
+        source.modified = modified;
+        g_texture_uploader.request(TEXTURE_FILEPATHS[i], [i](GLuint texture_id, const TextureLayout&)
+        {
+            finish_texture_reload(i, texture_id);
+        });
+        requested++;
+    }
+    if (requested == 0) LOG("No textures changed since they were loaded");
+}
+
+void write_trace(const char* filepath)
+{
+    int zones = Trace::write_chrome_json(filepath);
+    if (zones < 0) LOG("Couldn't write a trace to " << filepath);
+    else LOG("Wrote " << zones << " trace zones to " << filepath);
+}
 
+// the keys held down for as long as they're pressed, NUM_INPUT_KEYS for anything else
+InputKey held_key(SDL_Scancode scancode)
+{
+    switch (scancode)
+    {
+    case SDL_SCANCODE_LEFT:  return KEY_LEFT;
+    case SDL_SCANCODE_RIGHT: return KEY_RIGHT;
+    case SDL_SCANCODE_UP:    return KEY_THRUST;
+    default:                 return NUM_INPUT_KEYS;
+    }
+}
+
+// For keys whose work is allowed to allocate (exporting the trace, starting a
+// capture, reloading art...): this frame and the next ALLOC_WARMUP_FRAMES aren't held to strict mode
+void restart_alloc_warmup()
+{
+    g_steady_frames = 0;
+    AllocTracker::set_steady_state(false);
+}
+
+void process_input()
+{
+    TRACE_ZONE("input");
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
+        // keys can change the HUD (fuel, restart) and window events may have wiped the frame
+        if (event.type == SDL_KEYDOWN || event.type == SDL_WINDOWEVENT) g_needs_redraw = true;
+
         switch (event.type) {
         case SDL_QUIT:
         case SDL_WINDOWEVENT_CLOSE:
             g_app_status = TERMINATED;
             break;
+        case SDL_WINDOWEVENT:
+            // we won't hear about keys let go while another window has focus
+            if (event.window.event == SDL_WINDOWEVENT_FOCUS_LOST)
+            {
+                queue_input(KEY_RELEASE_ALL, false, event_counter(event.window.timestamp));
+            }
+            break;
+        case SDL_KEYUP:
+            if (held_key(event.key.keysym.scancode) != NUM_INPUT_KEYS)
+            {
+                queue_input(held_key(event.key.keysym.scancode), false, event_counter(event.key.timestamp));
+            }
+            break;
         case SDL_KEYDOWN:
+        {
+            if (event.key.repeat) break;
+            Uint64 counter = event_counter(event.key.timestamp);
+
+            if (held_key(event.key.keysym.scancode) != NUM_INPUT_KEYS)
+            {
+                queue_input(held_key(event.key.keysym.scancode), true, counter);
+                break;
+            }
+
             switch (event.key.keysym.sym)
             {
             case SDLK_q:
                 g_app_status = TERMINATED;
                 break;
+            case SDLK_F1:
+                g_overlay.toggle();
+                break;
+            // grab the last few seconds of zones without stopping the game
+            case SDLK_F2:
+                write_trace(TRACE_FILEPATH);
+                restart_alloc_warmup();
+                break;
+            // start or stop recording frames
+            case SDLK_F3:
+                if (g_frame_capture.is_running()) stop_capture();
+                else start_capture(g_capture_directory != NULL ? g_capture_directory : CAPTURE_DIRECTORY);
+                restart_alloc_warmup();
+                break;
+            // pick up edited art without restarting
+            case SDLK_F5:
+                reload_changed_textures();
+                restart_alloc_warmup();
+                break;
             case SDLK_SPACE:
-                if (g_game_state.ship->get_status() == START) {
-                    g_game_state.ship->set_status(ACTIVE);
-                }
+                queue_input(KEY_START, true, counter);
                 break;
             // for easier access
             case SDLK_r:
-                initialise();
+                queue_input(KEY_RESTART, true, counter);
+                restart_alloc_warmup();
                 break;
             case SDLK_a:
-                g_game_state.ship->set_fuel(g_game_state.ship->get_fuel() + 100);
+                queue_input(KEY_ADD_FUEL, true, counter);
                 break;
             case SDLK_d:
-                g_game_state.ship->set_fuel(g_game_state.ship->get_fuel() - 100);
+                queue_input(KEY_REMOVE_FUEL, true, counter);
                 break;
             }
-
+            break;
+        }
         default:
             break;
         }
     }
+}
 
-    const Uint8* key_state = SDL_GetKeyboardState(NULL);
-    if (key_state[SDL_SCANCODE_LEFT]) {
-        g_angle_dir = LEFT;
-    }
-    else if (key_state[SDL_SCANCODE_RIGHT]) {
-        g_angle_dir = RIGHT;
-    }
-    else if (key_state[SDL_SCANCODE_UP]) {
-        g_using_fuel = true;
-    }
-
+// true when the last frame we drew is still exactly what is on screen. A command
+// the simulation hasn't picked up yet counts as a change that's on its way
+bool frame_is_static()
+{
+    GameSnapshot const& snapshot = g_snapshots.get_front();
+    return !g_needs_redraw
+        && snapshot.status != ACTIVE
+        && snapshot.status == g_rendered_status
+        && snapshot.command_sequence == g_input_sequence
+        && g_texture_uploader.get_queue_depth() == 0;
 }
 
-void update()
+// ----- STEP TASKS ----- //
+void step_platforms_task(void*) { step_platforms(g_game_state, g_fixed_timestep); }
+void step_bubbles_task(void*)   { step_bubbles(g_game_state, g_fixed_timestep); }
+void step_ship_task(void*)      { step_ship(g_game_state, g_step_input, g_fixed_timestep); }
+
+// same order of events as step_simulation(), the shark and the bubbles just overlap
+void build_step_graph()
 {
-    float ticks = (float)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
-    float delta_time = ticks - g_previous_ticks;
-    g_previous_ticks = ticks;
+    int platforms = g_step_graph.add_task("platforms", step_platforms_task, nullptr);
+    int bubbles = g_step_graph.add_task("bubbles", step_bubbles_task, nullptr);
+    int ship = g_step_graph.add_task("ship", step_ship_task, nullptr);
+    g_step_graph.add_dependency(ship, platforms);
+    g_step_graph.add_dependency(ship, bubbles);
+    g_step_graph.start("step", g_task_workers);
+}
 
-    delta_time += g_accumulator;
+// copies the state out for render
+void publish_snapshot(Uint64 step_counter)
+{
+    GameSnapshot& snapshot = g_snapshots.get_back();
+    take_snapshot(g_game_state, snapshot);
+    snapshot.command_sequence = g_applied_sequence;
+    snapshot.step_total = g_sim_stats.steps;
+    snapshot.step_counter = step_counter;
+    g_snapshots.publish();
+}
 
-    if (delta_time < FIXED_TIMESTEP)
+// runs every step that has come due and publishes the result. Shared by update()
+// and the simulation thread, each with their own counter and accumulator
+int run_due_steps(Uint64& previous_counter, Uint64& accumulator)
+{
+    TRACE_ZONE("update");
+    // integer counter ticks so nothing drifts no matter how long the game has been up
+    Uint64 counter = SDL_GetPerformanceCounter();
+    accumulator += counter - previous_counter;
+    previous_counter = counter;
+
+    // catch up on whole steps, but only so many per frame so one long stall
+    // (debugger, window drag) can't snowball into every frame running long
+    int steps = 0;
+    Uint64 step_end = counter - accumulator + g_step_ticks;
+    while (accumulator >= g_step_ticks)
     {
-        g_accumulator = delta_time;
-        return;
+        if (steps == g_max_steps_per_frame)
+        {
+            Uint64 dropped = accumulator / g_step_ticks;
+            g_sim_stats.dropped_steps += dropped;
+            accumulator -= dropped * g_step_ticks;
+            break;
+        }
+
+        // only what happened before this step ends, the rest waits for its own step
+        SimInput input = g_input_latch.latch(g_input_queue, step_end);
+        g_replay_recorder.record(g_sim_stats.steps + steps, input);
+        apply_commands(g_game_state, g_initial_state, input);
+        EntityStatus status_before = g_game_state.ship->get_status();
+        g_step_input = input;
+        g_step_graph.run();
+        g_applied_sequence = input.sequence;
+        if (g_telemetry.is_open())
+        {
+            if (input.commands & COMMAND_RESET) g_telemetry_run++;
+            TelemetryTick tick;
+            fill_telemetry_tick(tick, g_game_state, input, status_before, g_telemetry_run);
+            g_telemetry.record(g_sim_stats.steps + steps, tick);
+        }
+        if (BinaryLog::is_running())
+        {
+            BINLOG("step %llu angle %d fuel %d commands %u", g_sim_stats.steps + steps, input.angle_dir,
+                input.using_fuel, input.commands);
+            g_game_state.ship->log_attributes();
+        }
+        accumulator -= g_step_ticks;
+        step_end += g_step_ticks;
+        steps++;
     }
 
-    while (delta_time >= FIXED_TIMESTEP)
-    {
-        // only update the game if the ship is moving
-        if (g_game_state.ship->get_status() == ACTIVE) {
-            // update angle first
-            if (g_angle_dir != NONE) {
-                g_game_state.ship->rotate(FIXED_TIMESTEP, g_angle_dir);
-            }
+    g_sim_stats.frames++;
+    g_sim_stats.steps += steps;
+    if (steps > 1) g_sim_stats.caught_up_steps += steps - 1;
+    g_sim_stats.last_frame_steps = steps;
 
-            for (int i = 0; i < NUM_PLATFORMS; i++) 
-            {
-                g_game_state.platforms[i].update(FIXED_TIMESTEP, nullptr, 0);
-            }
+    // the state is now as of (counter - accumulator), render blends on from there
+    if (steps > 0) publish_snapshot(counter - accumulator);
+    return steps;
+}
 
-            for (size_t i = g_game_state.bubbles.size(); i > 0; i--) {
-                size_t index = i - 1;
-                if (g_game_state.bubbles[index]->get_index() == 7) {
-                    delete g_game_state.bubbles[index];  // Free memory
-                    g_game_state.bubbles[index] = nullptr; // Prevent dangling pointer
-                    g_game_state.bubbles.erase(g_game_state.bubbles.begin() + index);  // Remove from vector
-                }
-                else {
-                    g_game_state.bubbles[index]->update(FIXED_TIMESTEP, nullptr, 0);
-                }
+// only used with --no-sim-thread, otherwise simulation_thread() does this
+void update()
+{
+    run_due_steps(g_previous_counter, g_accumulator);
+}
 
-            }
+// steps the game at the fixed rate no matter how long frames take to draw
+void simulation_thread()
+{
+    TRACE_THREAD_NAME("simulation");
+    AllocScope scope("simulation");
+    Uint64 previous_counter = SDL_GetPerformanceCounter();
+    Uint64 accumulator = 0;
+    Uint64 frequency = SDL_GetPerformanceFrequency();
 
-            g_game_state.ship->update_fuel(FIXED_TIMESTEP, g_using_fuel, g_game_state.bubbles, g_bubble_texture_id);
-            g_game_state.ship->update(FIXED_TIMESTEP, g_game_state.platforms, NUM_PLATFORMS);
+    while (g_simulation_running.load(std::memory_order_acquire))
+    {
+        run_due_steps(previous_counter, accumulator);
+
+        // outside ACTIVE nothing moves, so until a key arrives there's nothing
+        // to step, record or publish. Wait for one, then start the clock over
+        // so the time spent asleep isn't caught up on
+        if (g_game_state.ship->get_status() != ACTIVE && g_input_queue.peek() == nullptr)
+        {
+            TRACE_ZONE("idle");
+            std::unique_lock<std::mutex> lock(g_simulation_idle_mutex);
+            g_simulation_wake.wait(lock, []
+            {
+                return !g_simulation_running.load(std::memory_order_acquire) || g_input_queue.peek() != nullptr;
+            });
+            previous_counter = SDL_GetPerformanceCounter();
+            accumulator = 0;
+            continue;
         }
-        // decrement
-        delta_time -= FIXED_TIMESTEP;
+
+        // sleep off most of the wait until the next step. SDL_Delay can
+        // oversleep by a millisecond so it wakes early and yields the rest
+        Uint64 remaining_ms = (g_step_ticks - accumulator) * 1000 / frequency;
+        if (remaining_ms > 1) SDL_Delay((Uint32)(remaining_ms - 1));
+        else std::this_thread::yield();
     }
+}
 
-    g_accumulator = delta_time;
+
+// ----- FRAME TASKS ----- //
+// render() runs these through g_frame_graph: the HUD text and the sprite list
+// (see Frame.h) get built side by side, then submit_frame() does every GL call
+// on this thread
+
+void build_hud_task(void*)
+{
+    build_hud(g_frame.data, *g_frame.snapshot);
 }
 
+void build_sprites_task(void*)
+{
+    build_sprites(g_frame.data, *g_frame.snapshot, g_frame.alpha);
+}
 
-void render()
+void build_overlay_task(void*)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
+    g_frame.overlay_count = 0;
+    if (!g_overlay.is_visible()) return;
 
-    std::string fuel_string = "FUEL: " + std::to_string(g_game_state.ship->get_fuel());
-    glm::vec3 curr_velocity = g_game_state.ship->get_velocity();
-    std::string x_velocity = "X_SPEED " + std::to_string(int(curr_velocity.x*100));
-    std::string y_velocity = "Y_SPEED: " + std::to_string(int(curr_velocity.y*100));
-    std::string angle_str = "ANGLE: " + std::to_string(((int(g_game_state.ship->get_angle()) % 360) + 360) % 360);
+    int line_count = g_overlay.build_lines();
+    for (int i = 0; i < line_count; i++)
+    {
+        build_text(g_frame.overlay[i], g_overlay.get_line(i), 0.15f, 0.03f, glm::vec3(-4.8f, 3.5f - 0.2f * i, 0.0f));
+    }
+    g_frame.overlay_count = line_count;
+}
 
-    // render text
-    draw_text(&g_shader_program, g_font_texture_id, fuel_string, 0.25f, 0.05f, glm::vec3(3.0f, 3.5f, 0.0f));
-    draw_text(&g_shader_program, g_font_texture_id, x_velocity, 0.25f, 0.05f, glm::vec3(3.0f, 3.25f, 0.0f));
-    draw_text(&g_shader_program, g_font_texture_id, y_velocity, 0.25f, 0.05f, glm::vec3(3.0f, 3.0f, 0.0f));
-    draw_text(&g_shader_program, g_font_texture_id, angle_str, 0.25f, 0.05f, glm::vec3(3.0f, 2.75f, 0.0f));
+// pinned to the main thread, the only one with the GL context
+void submit_frame(void*)
+{
+    g_renderer.begin_frame();
+    int draw_calls = draw_frame(g_renderer, g_font_texture_id, g_frame.data);
 
+    // on top of everything else
+    for (int i = 0; i < g_frame.overlay_count; i++)
+    {
+        g_renderer.draw_text(g_font_texture_id, g_frame.overlay[i]);
+    }
+    g_renderer.end_frame();
+    g_last_draw_calls = draw_calls + g_frame.overlay_count;
 
-    // THINGS TO RENDER //
-    // render all of these regardless of game state
+    // reads the back buffer before the swap, only queues the copy
+    g_frame_capture.capture();
 
-    g_game_state.ship->render(&g_shader_program);
-    for (int i = 0; i < NUM_PLATFORMS; i++) 
     {
-        g_game_state.platforms[i].render(&g_shader_program);
+        TRACE_ZONE("swap");
+        SDL_GL_SwapWindow(g_display_window);
     }
 
-    for (size_t i = g_game_state.bubbles.size(); i > 0; i--) {
-        g_game_state.bubbles[i-1]->render(&g_shader_program);
+    // as close to input-to-photon as we can see from here: the swap that first
+    // carries the press has returned (the display still has to scan it out)
+    if (g_latency.pending_sequence != 0 && g_frame.snapshot->command_sequence >= g_latency.pending_sequence)
+    {
+        float latency_ms = elapsed_ms(g_latency.pending_counter);
+        g_latency.samples++;
+        g_latency.total_ms += latency_ms;
+        g_latency.worst_ms = std::max(g_latency.worst_ms, latency_ms);
+        g_latency.pending_sequence = 0;
     }
+}
 
+void render()
+{
+    TRACE_ZONE("render");
+    // finish off any streamed textures, never blocks
+    g_texture_uploader.pump();
+
+    // newest state the simulation has finished, it may step again while we draw
+    g_frame.snapshot = &g_snapshots.get_front();
+
+    // drawn part way between the last two steps, by how far we are into the next one.
+    // Once play stops the last step is final, which static screens rely on
+    Uint64 since_step = SDL_GetPerformanceCounter() - g_frame.snapshot->step_counter;
+    g_frame.alpha = g_frame.snapshot->status == ACTIVE
+        ? (float)since_step / (float)g_step_ticks
+        : 1.0f;
+
+    FrameSample sample;
+    Uint64 counter = SDL_GetPerformanceCounter();
+    sample.frame_ms = (float)(counter - g_last_frame_counter) * MILLISECONDS_IN_SECOND / (float)SDL_GetPerformanceFrequency();
+    sample.sim_steps = (int)(g_frame.snapshot->step_total - g_last_frame_step_total);
+#ifdef COUNT_GL_CALLS
+    GLFrameCounts const& gl_counts = GLCounter::get_last_frame();
+    sample.draw_calls = (int)gl_counts.calls[GL_CALL_DRAW_ARRAYS];
+    sample.gl_state_changes = (int)GLCounter::state_changes(gl_counts);
+    sample.gl_kilobytes = (int)(GLCounter::total_bytes(gl_counts) / 1024);
+#else
+    sample.draw_calls = g_last_draw_calls;
+    sample.gl_state_changes = 0;
+    sample.gl_kilobytes = 0;
+#endif
+    sample.entity_count = 1 + NUM_PLATFORMS + g_frame.snapshot->bubble_count;
+    sample.bubble_count = g_frame.snapshot->bubble_count;
+    sample.uploads_queued = g_texture_uploader.get_queue_depth();
+    sample.upload_kilobytes = (int)(g_texture_uploader.get_bytes_in_flight() / 1024);
+    g_overlay.add_sample(sample);
+    g_last_frame_counter = counter;
+    g_last_frame_step_total = g_frame.snapshot->step_total;
+
+    g_frame_graph.run();
+}
 
+void build_frame_graph()
+{
+    int hud = g_frame_graph.add_task("hud", build_hud_task, nullptr);
+    int sprites = g_frame_graph.add_task("sprites", build_sprites_task, nullptr);
+    int overlay = g_frame_graph.add_task("overlay", build_overlay_task, nullptr);
+    int submit = g_frame_graph.add_task("submit", submit_frame, nullptr, true);
+    g_frame_graph.add_dependency(submit, hud);
+    g_frame_graph.add_dependency(submit, sprites);
+    g_frame_graph.add_dependency(submit, overlay);
+    g_frame_graph.start("frame", g_task_workers);
+}
 
-    // render at start
-    if (g_game_state.ship->get_status() == START)
-    {
-        draw_text(&g_shader_program, g_font_texture_id, "PRESS SPACE TO BEGIN", 0.25f, 0.05f, glm::vec3(-1.2f, 0.0f, 0.0f));
-    }
-    // render at collsion
-    else if (g_game_state.ship->get_status() == CRASHED)
+
+void shutdown()
+{
+    if (g_simulation_thread.joinable())
     {
-        draw_text(&g_shader_program, g_font_texture_id, "MISSION FAILED", 0.25f, 0.05f, glm::vec3(-1.2f, 0.0f, 0.0f));
+        g_simulation_running = false;
+        wake_simulation();
+        g_simulation_thread.join();
     }
-    else if (g_game_state.ship->get_status() == LANDED)
+    g_step_graph.shutdown();
+    g_frame_graph.shutdown();
+    if (g_trace_on_exit != NULL) write_trace(g_trace_on_exit);
+    if (g_replay_recorder.is_open())
     {
-        draw_text(&g_shader_program, g_font_texture_id, "MISSION ACCOMPLISHED", 0.25f, 0.05f, glm::vec3(-1.2f, 0.0f, 0.0f));
+        g_replay_recorder.close(g_sim_stats.steps, g_game_state.ship->get_status());
+        LOG("Recorded " << g_sim_stats.steps << " steps to " << g_record_filepath);
     }
-    else if (g_game_state.ship->get_position().y > 5.0f)
+
+    if (g_telemetry.is_open())
     {
-        draw_text(&g_shader_program, g_font_texture_id, "The Sky is the Limit", 0.25f, 0.05f, glm::vec3(-1.2f, -1.0f, 0.0f));
-        draw_text(&g_shader_program, g_font_texture_id, "Good Luck Getting Back Down Here", 0.25f, 0.05f, glm::vec3(-2.0f, -1.3f, 0.0f));
+        g_telemetry.close();
+        LOG("Wrote " << g_telemetry.get_ticks() << " steps of telemetry to " << g_telemetry_filepath << ", "
+            << g_telemetry.get_dropped() << " dropped");
     }
-    else if (g_game_state.ship->get_fuel() == 0)
+
+    stop_capture();
+    if (BinaryLog::is_running())
     {
-        draw_text(&g_shader_program, g_font_texture_id, "and you're outta fuel", 0.25f, 0.05f, glm::vec3(-1.5f, -1.0f, 0.0f));
+        BinaryLog::shutdown();
+        LOG("Logged " << BinaryLog::get_written() << " records, " << BinaryLog::get_dropped() << " dropped");
     }
-
-    SDL_GL_SwapWindow(g_display_window);
-}
-
-
-void shutdown()
-{
+    g_texture_uploader.shutdown();
+    GLCounter::close_csv();
     SDL_Quit();
 
-    // delete pointers
-    for (size_t i = g_game_state.bubbles.size(); i > 0; i--) {
-        delete g_game_state.bubbles[i - 1];
+    free_game_state(g_game_state);
+
+    AllocTracker::report();
+    g_step_graph.report();
+    g_frame_graph.report();
+    LOG("Simulation: " << g_sim_stats.steps << " steps over " << g_sim_stats.frames << " frames, "
+        << g_sim_stats.caught_up_steps << " caught up, " << g_sim_stats.dropped_steps << " dropped");
+    if (g_latency.samples > 0)
+    {
+        LOG("Input to photon: " << g_latency.total_ms / g_latency.samples << " ms average, "
+            << g_latency.worst_ms << " ms worst over " << g_latency.samples << " presses");
     }
 }
 
 // ----- GAME LOOP ----- //
 int main(int argc, char* argv[])
 {
+    for (int i = 1; i < argc; i++)
+    {
+        // fail on any allocation once the game has warmed up, needs TRACK_ALLOCATIONS
+        if (strcmp(argv[i], "--alloc-strict") == 0) AllocTracker::set_strict(true);
+        // cap on simulation steps a single frame may run to catch up
+        if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) g_max_steps_per_frame = std::max(1, atoi(argv[++i]));
+        // vsync (default), sleep or off, and the frame rate sleep mode aims for
+        if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "sleep") == 0) g_pacing_mode = PACING_SLEEP;
+            else if (strcmp(argv[i], "off") == 0) g_pacing_mode = PACING_UNLIMITED;
+            else g_pacing_mode = PACING_VSYNC;
+        }
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) g_target_fps = atoi(argv[++i]);
+        // simulation steps per second, independent of the display rate
+        if (strcmp(argv[i], "--sim-hz") == 0 && i + 1 < argc) g_fixed_timestep = 1.0f / std::max(1, atoi(argv[++i]));
+        // step the simulation from the main loop instead of its own thread
+        if (strcmp(argv[i], "--no-sim-thread") == 0) g_threaded_simulation = false;
+        // per frame GL call counts, needs COUNT_GL_CALLS
+        if (strcmp(argv[i], "--gl-csv") == 0 && i + 1 < argc && !GLCounter::open_csv(argv[++i])) LOG("Couldn't open " << argv[i]);
+        // write the trace zones out on quit as well as on F2
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) g_trace_on_exit = argv[++i];
+        // worker threads per task graph, 0 runs every task on the calling thread
+        if (strcmp(argv[i], "--task-workers") == 0 && i + 1 < argc) g_task_workers = std::max(0, atoi(argv[++i]));
+        // every step's input, for tools/replay.cpp
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) g_record_filepath = argv[++i];
+        // the ship's state every step into a binary log, tools/log_decode.cpp reads it
+        if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) g_log_filepath = argv[++i];
+        // every step's ship state into a memory mapped column file, see Telemetry.h
+        if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) g_telemetry_filepath = argv[++i];
+        // record every frame drawn from the start, F3 toggles it either way
+        if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) g_capture_directory = argv[++i];
+        // png (default) or raw, raw is PPM and cheaper to write but about a hundred times bigger
+        if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc)
+        {
+            i++;
+            g_capture_format = strcmp(argv[i], "raw") == 0 ? CAPTURE_RAW : CAPTURE_PNG;
+        }
+    }
+
+    if (AllocTracker::is_strict() && !AllocTracker::is_tracking())
+    {
+        LOG("--alloc-strict does nothing in a build without TRACK_ALLOCATIONS");
+    }
+
+    // before anything starts stepping so the first step is in it
+    if (g_log_filepath != NULL && !BinaryLog::start(strcmp(g_log_filepath, "-") == 0 ? nullptr : g_log_filepath))
+    {
+        LOG("Couldn't open " << g_log_filepath);
+    }
+    if (g_record_filepath != NULL && !g_replay_recorder.open(g_record_filepath, (int)(1.0f / g_fixed_timestep + 0.5f)))
+    {
+        LOG("Couldn't open " << g_record_filepath);
+    }
+
+    TRACE_THREAD_NAME("main");
     initialise();
 
     while (g_app_status == RUNNING)
     {
-        process_input();
-        update();
-        render();
+        g_snapshots.update_front();
+
+        if (frame_is_static())
+        {
+            // sleep until there's an event (left in the queue for process_input),
+            // then pretend no time passed so the simulation doesn't try to catch up
+            // (the simulation thread is asleep as well until a key reaches it)
+            SDL_WaitEventTimeout(NULL, IDLE_WAIT_MILLISECONDS);
+            g_previous_counter = SDL_GetPerformanceCounter();
+            g_last_frame_counter = g_previous_counter; // keep the wait out of the frame times
+        }
+
+        AllocTracker::set_steady_state(g_steady_frames >= ALLOC_WARMUP_FRAMES);
+        AllocTracker::begin_frame();
+        {
+            AllocScope scope("input");
+            process_input();
+        }
+        if (!g_threaded_simulation)
+        {
+            AllocScope scope("update");
+            update();
+        }
+        g_snapshots.update_front();
+        bool rendered = !frame_is_static();
+        if (rendered)
+        {
+            AllocScope scope("render");
+            GLCounter::begin_frame();
+            render();
+            GLCounter::end_frame();
+            g_needs_redraw = false;
+            g_rendered_status = g_snapshots.get_front().status;
+        }
+        AllocTracker::end_frame();
+        g_steady_frames++;
+
+        if (rendered)
+        {
+            TRACE_ZONE("pacing");
+            g_frame_pacer.wait_for_next_frame();
+        }
     }
 
     shutdown();
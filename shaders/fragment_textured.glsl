@@ -1,7 +1,24 @@
 
 uniform sampler2D diffuse;
+uniform int textureFormat;      // 0 RGBA, 1 palette indices, 2 1-bit mask (see TextureEncoding.h)
+uniform vec2 textureSize;       // in pixels, before any packing
+uniform vec4 palette[16];
 varying vec2 texCoordVar;
 
 void main() {
-    gl_FragColor = texture2D(diffuse, texCoordVar);
+    if (textureFormat == 0) {
+        gl_FragColor = texture2D(diffuse, texCoordVar);
+    }
+    else if (textureFormat == 1) {
+        float index = floor(texture2D(diffuse, texCoordVar).a * 255.0 + 0.5);
+        gl_FragColor = palette[int(index)];
+    }
+    else {
+        // eight pixels per byte, find the byte for this pixel and then its bit
+        float x = min(floor(texCoordVar.x * textureSize.x), textureSize.x - 1.0);
+        float row_bytes = ceil(textureSize.x / 8.0);
+        float byte_value = floor(texture2D(diffuse, vec2((floor(x / 8.0) + 0.5) / row_bytes, texCoordVar.y)).a * 255.0 + 0.5);
+        float bit = mod(floor(byte_value / exp2(mod(x, 8.0)) + 0.0001), 2.0);
+        gl_FragColor = palette[int(bit)];
+    }
 }
@@ -0,0 +1,503 @@
+// Microbenchmarks for the CPU side of a frame: entity updates, SAT collision
+// and the geometry under it, fuel and bubble spawning, text vertex generation
+// and bubble churn. Nothing here opens a window or makes a GL context, so it
+// runs fine on a headless Linux box.
+//
+// Usage: benchmark [--filter TEXT] [--json FILE] [--repetitions N]
+//                  [--warmup N] [--min-time-ms N] [--counters]
+//
+// Each benchmark picks an iteration count that takes at least --min-time-ms,
+// throws away --warmup repetitions and then times --repetitions more. The
+// median and the median absolute deviation (MAD) per iteration get reported,
+// both hold up much better than mean and stddev when the OS interrupts a run.
+//
+// --counters also reads the hardware counters in perf_counters.h around every
+// repetition and reports the median per iteration of each, to tell whether
+// something is bound on cache misses, branch misses or plain instructions.
+
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "../Entity.h"
+#include "../Simulation.h"
+#include "../Text.h"
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// ----- HARNESS ----- //
+
+// off unless --counters opened them, start()/stop() do nothing then
+PerfCounters g_counters;
+
+// handed to every benchmark, which does its setup and then brackets only the
+// timed loop with start()/stop()
+struct BenchContext
+{
+    uint64_t iterations;
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point stop_time;
+
+    void start()
+    {
+        g_counters.start();
+        start_time = std::chrono::steady_clock::now();
+    }
+
+    void stop()
+    {
+        stop_time = std::chrono::steady_clock::now();
+        g_counters.stop();
+    }
+
+    double elapsed_ns() const { return std::chrono::duration<double, std::nano>(stop_time - start_time).count(); }
+};
+
+typedef void (*BenchFunction)(BenchContext&);
+
+struct Benchmark
+{
+    const char*   name;
+    BenchFunction run;
+};
+
+struct BenchResult
+{
+    const char* name;
+    uint64_t    iterations;
+    int         repetitions;
+    double      median_ns;
+    double      mad_ns;
+    double      min_ns;
+    double      max_ns;
+    double      counters[PERF_COUNTER_COUNT];   // per iteration, medians
+};
+
+// one timed repetition, everything per iteration
+struct BenchSample
+{
+    double ns;
+    double counters[PERF_COUNTER_COUNT];
+};
+
+// results get folded in here so the optimiser can't throw the work away
+volatile float g_sink = 0.0f;
+
+constexpr float FIXED_TIMESTEP = 1.0f / 60.0f;
+
+double median(std::vector<double> values)
+{
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    double upper = values[middle];
+    if (values.size() % 2 == 1) return upper;
+
+    double lower = *std::max_element(values.begin(), values.begin() + middle);
+    return (lower + upper) / 2.0;
+}
+
+BenchSample run_repetition(BenchFunction run, uint64_t iterations)
+{
+    BenchContext context = {};
+    context.iterations = iterations;
+    run(context);
+
+    BenchSample sample;
+    sample.ns = context.elapsed_ns() / iterations;
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        sample.counters[i] = g_counters.get((PerfCounter)i) / iterations;
+    }
+    return sample;
+}
+
+BenchResult run_benchmark(const Benchmark& benchmark, int warmup, int repetitions, double min_time_ns)
+{
+    // keep doubling until one repetition is long enough for the clock to be noise
+    uint64_t iterations = 1;
+    while (iterations < (1ull << 32))
+    {
+        BenchContext context = {};
+        context.iterations = iterations;
+        benchmark.run(context);
+        if (context.elapsed_ns() >= min_time_ns) break;
+        iterations *= 2;
+    }
+
+    for (int i = 0; i < warmup; i++)
+    {
+        run_repetition(benchmark.run, iterations);
+    }
+
+    std::vector<double> samples(repetitions);
+    std::vector<double> counter_samples[PERF_COUNTER_COUNT];
+    for (int i = 0; i < repetitions; i++)
+    {
+        BenchSample sample = run_repetition(benchmark.run, iterations);
+        samples[i] = sample.ns;
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+        {
+            counter_samples[c].push_back(sample.counters[c]);
+        }
+    }
+
+    BenchResult result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.repetitions = repetitions;
+    result.median_ns = median(samples);
+    result.min_ns = *std::min_element(samples.begin(), samples.end());
+    result.max_ns = *std::max_element(samples.begin(), samples.end());
+
+    std::vector<double> deviations(repetitions);
+    for (int i = 0; i < repetitions; i++)
+    {
+        deviations[i] = samples[i] > result.median_ns ? samples[i] - result.median_ns : result.median_ns - samples[i];
+    }
+    result.mad_ns = median(deviations);
+
+    for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+    {
+        result.counters[c] = median(counter_samples[c]);
+    }
+    return result;
+}
+
+bool write_json(const char* filepath, const std::vector<BenchResult>& results, int warmup, double min_time_ms)
+{
+    FILE* file = fopen(filepath, "w");
+    if (file == nullptr) return false;
+
+    fprintf(file, "{\n  \"warmup\": %d,\n  \"min_time_ms\": %.1f,\n  \"benchmarks\": [\n", warmup, min_time_ms);
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& result = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"iterations\": %llu, \"repetitions\": %d, "
+            "\"median_ns\": %.3f, \"mad_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f",
+            result.name, (unsigned long long)result.iterations, result.repetitions,
+            result.median_ns, result.mad_ns, result.min_ns, result.max_ns);
+
+        // only the counters that actually opened
+        if (g_counters.is_open())
+        {
+            fprintf(file, ", \"counters\": {");
+            bool first = true;
+            for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+            {
+                if (!g_counters.has((PerfCounter)c)) continue;
+                fprintf(file, "%s\"%s\": %.3f", first ? "" : ", ", PerfCounters::get_name((PerfCounter)c), result.counters[c]);
+                first = false;
+            }
+            fprintf(file, "}");
+        }
+        fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+// ----- FIXTURES ----- //
+// copies of the level exactly as the game builds it, minus the textures
+InitialState g_level;
+
+Entity make_ship()
+{
+    Entity ship = g_level.ship;
+    ship.set_status(ACTIVE);
+    return ship;
+}
+
+void make_platforms(Entity* platforms)
+{
+    for (int i = 0; i < NUM_PLATFORMS; i++)
+    {
+        platforms[i] = g_level.platforms[i];
+    }
+}
+
+void free_bubbles(std::vector<Entity*>& bubbles)
+{
+    for (size_t i = 0; i < bubbles.size(); i++)
+    {
+        delete bubbles[i];
+    }
+    bubbles.clear();
+}
+
+// ----- BENCHMARKS ----- //
+
+// the ship against all three platforms, clear of every one so the SAT runs in full
+void bench_ship_update(BenchContext& context)
+{
+    Entity platforms[NUM_PLATFORMS];
+    make_platforms(platforms);
+    Entity ship = make_ship();
+    ship.set_acceleration(glm::vec3(0.0f, -Entity::GRAVITY, 0.0f));
+    glm::vec3 start = ship.get_position();
+
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        // put it back each time so it never falls out of the level
+        ship.set_position(start);
+        ship.set_velocity(glm::vec3(0.0f));
+        ship.update(FIXED_TIMESTEP, platforms, NUM_PLATFORMS);
+    }
+    context.stop();
+    g_sink = g_sink + ship.get_position().y;
+}
+
+// moving platforms update with nothing to collide against
+void bench_shark_update(BenchContext& context)
+{
+    Entity platforms[NUM_PLATFORMS];
+    make_platforms(platforms);
+    Entity& shark = platforms[1];
+
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        shark.update(FIXED_TIMESTEP, nullptr, 0);
+    }
+    context.stop();
+    g_sink = g_sink + shark.get_position().x;
+}
+
+// the first axis separates them, the usual case
+void bench_sat_miss(BenchContext& context)
+{
+    Entity platforms[NUM_PLATFORMS];
+    make_platforms(platforms);
+    Entity ship = make_ship();
+
+    int hits = 0;
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        hits += ship.check_collision_SAT(&platforms[0]);
+    }
+    context.stop();
+    g_sink = g_sink + (float)hits;
+}
+
+// overlapping, so every one of the eight axes gets projected
+void bench_sat_hit(BenchContext& context)
+{
+    Entity platforms[NUM_PLATFORMS];
+    make_platforms(platforms);
+    Entity ship = make_ship();
+    ship.set_position(platforms[0].get_position() + glm::vec3(0.1f, 0.2f, 0.0f));
+    ship.rotate(1.0f / 3.0f, LEFT);   // 30 degrees, so no axes are shared
+
+    int hits = 0;
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        hits += ship.check_collision_SAT(&platforms[0]);
+    }
+    context.stop();
+    g_sink = g_sink + (float)hits;
+}
+
+void bench_get_corners(BenchContext& context)
+{
+    Entity ship = make_ship();
+    ship.rotate(0.5f, LEFT);
+
+    float total = 0.0f;
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        std::array<glm::vec2, 4> corners = ship.get_corners();
+        total += corners[i & 3].x;
+    }
+    context.stop();
+    g_sink = g_sink + total;
+}
+
+void bench_get_min_max_x(BenchContext& context)
+{
+    Entity ship = make_ship();
+    ship.rotate(0.5f, LEFT);
+
+    float total = 0.0f;
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        std::pair<float, float> range = ship.get_min_max_x();
+        total += range.second - range.first;
+    }
+    context.stop();
+    g_sink = g_sink + total;
+}
+
+// thrusting with fuel set so every call spawns, recycling through the pool
+// like the game does once it has warmed up
+void bench_update_fuel_spawn(BenchContext& context)
+{
+    Entity ship = make_ship();
+    std::vector<Entity*> bubbles;
+    std::vector<Entity*> bubble_pool;
+    bubbles.reserve(MAX_BUBBLES);
+    bubble_pool.reserve(MAX_BUBBLES);
+
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        ship.set_fuel(Entity::FUEL_PER_TIME + 20);
+        ship.update_fuel(FIXED_TIMESTEP, true, bubbles, bubble_pool, 0);
+        if (bubbles.size() == MAX_BUBBLES)
+        {
+            bubble_pool.insert(bubble_pool.end(), bubbles.begin(), bubbles.end());
+            bubbles.clear();
+        }
+    }
+    context.stop();
+    g_sink = g_sink + (float)bubbles.size();
+
+    free_bubbles(bubbles);
+    free_bubbles(bubble_pool);
+}
+
+// one HUD line, batch reused like build_hud() does every frame
+void bench_build_text(BenchContext& context)
+{
+    TextBatch batch;
+
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        build_text(batch, "FUEL: 1000", 0.25f, 0.05f, glm::vec3(3.0f, 3.5f, 0.0f));
+    }
+    context.stop();
+    g_sink = g_sink + batch.vertices[0];
+}
+
+// a full thrust step for the bubbles: spawn, update the live ones, pop the
+// finished ones back into the pool
+void bench_bubble_churn(BenchContext& context)
+{
+    Entity platforms[NUM_PLATFORMS];
+    make_platforms(platforms);
+    Entity ship = make_ship();
+
+    GameState state;
+    state.ship = &ship;
+    state.platforms = platforms;
+    state.bubble_texture_id = 0;
+    state.bubbles.reserve(MAX_BUBBLES);
+    state.bubble_pool.reserve(MAX_BUBBLES);
+
+    glm::vec3 start = ship.get_position();
+    context.start();
+    for (uint64_t i = 0; i < context.iterations; i++)
+    {
+        if (ship.get_fuel() < 20) ship.set_fuel(1000);
+        ship.set_position(start);
+        ship.update_fuel(FIXED_TIMESTEP, true, state.bubbles, state.bubble_pool, 0);
+        step_bubbles(state, FIXED_TIMESTEP);
+    }
+    context.stop();
+    g_sink = g_sink + (float)state.bubbles.size();
+
+    free_bubbles(state.bubbles);
+    free_bubbles(state.bubble_pool);
+}
+
+const Benchmark BENCHMARKS[] = {
+    { "entity_update_ship",     bench_ship_update },
+    { "entity_update_shark",    bench_shark_update },
+    { "sat_collision_miss",     bench_sat_miss },
+    { "sat_collision_hit",      bench_sat_hit },
+    { "get_corners",            bench_get_corners },
+    { "get_min_max_x",          bench_get_min_max_x },
+    { "update_fuel_spawn",      bench_update_fuel_spawn },
+    { "build_text",             bench_build_text },
+    { "bubble_churn",           bench_bubble_churn },
+};
+
+int main(int argc, char* argv[])
+{
+    const char* filter = nullptr;
+    const char* json_filepath = nullptr;
+    int repetitions = 30;
+    int warmup = 3;
+    double min_time_ms = 10.0;
+    bool counters = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_filepath = argv[++i];
+        else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) repetitions = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) min_time_ms = std::max(0.01, atof(argv[++i]));
+        else if (strcmp(argv[i], "--counters") == 0) counters = true;
+        else
+        {
+            LOG("Usage: benchmark [--filter TEXT] [--json FILE] [--repetitions N] [--warmup N] [--min-time-ms N] [--counters]");
+            return 1;
+        }
+    }
+
+    if (counters && !g_counters.open())
+    {
+        LOG("WARNING: no hardware counters available (no PMU, or perf_event_paranoid too high), timing only");
+    }
+
+    GameState level_state = {};
+    build_level(level_state, g_level, LevelTextures());
+    free_game_state(level_state);
+
+    std::vector<BenchResult> results;
+    printf("%-24s %12s %12s %8s %12s\n", "benchmark", "median ns", "mad ns", "mad %", "iterations");
+    for (const Benchmark& benchmark : BENCHMARKS)
+    {
+        if (filter != nullptr && strstr(benchmark.name, filter) == nullptr) continue;
+
+        BenchResult result = run_benchmark(benchmark, warmup, repetitions, min_time_ms * 1e6);
+        results.push_back(result);
+        printf("%-24s %12.2f %12.2f %7.1f%% %12llu\n", result.name, result.median_ns, result.mad_ns,
+            result.median_ns > 0.0 ? 100.0 * result.mad_ns / result.median_ns : 0.0,
+            (unsigned long long)result.iterations);
+    }
+
+    if (g_counters.is_open())
+    {
+        // per iteration; a dash is a counter this CPU doesn't have
+        printf("\n%-24s", "benchmark");
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+        {
+            printf(" %14s", PerfCounters::get_name((PerfCounter)c));
+        }
+        printf(" %6s\n", "ipc");
+
+        for (const BenchResult& result : results)
+        {
+            printf("%-24s", result.name);
+            for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+            {
+                if (g_counters.has((PerfCounter)c)) printf(" %14.2f", result.counters[c]);
+                else printf(" %14s", "-");
+            }
+            if (g_counters.has(PERF_CYCLES) && g_counters.has(PERF_INSTRUCTIONS) && result.counters[PERF_CYCLES] > 0.0)
+            {
+                printf(" %6.2f\n", result.counters[PERF_INSTRUCTIONS] / result.counters[PERF_CYCLES]);
+            }
+            else printf(" %6s\n", "-");
+        }
+    }
+
+    if (json_filepath != nullptr && !write_json(json_filepath, results, warmup, min_time_ms))
+    {
+        LOG("ERROR: could not write " << json_filepath);
+        return 1;
+    }
+    return 0;
+}
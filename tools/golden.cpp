@@ -0,0 +1,244 @@
+// Golden image checks and rendering cost numbers, through SoftwareRenderer so
+// neither a GPU nor a display is needed. Each scene plays a replay (see
+// Replay.h) up to a step, builds and draws that frame through Frame.h the way
+// the game does and compares it against replays/golden/<scene>.ppm.
+//
+// Usage: golden [--update] [--threshold N] [--max-differing N] [--workers N]
+//               [--width W] [--height H] [--out DIR] [--bench FRAMES]
+//
+// A pixel differs if any channel is more than --threshold (2) off, and a scene
+// fails once more than --max-differing (0) pixels do. Failing frames are
+// written to --out (golden_out) to look at next to the golden ones. --update
+// rewrites the golden images instead, do that when a change is meant to alter
+// what gets drawn.
+//
+// --bench renders every scene that many more times and reports what a frame
+// costs. The goldens are 320x240 to keep them small, pass --width 960 --height
+// 720 to time the game's real window size (no comparing happens then).
+
+#define LOG(argument) std::cout << argument << '\n'
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "../Frame.h"
+#include "../Replay.h"
+#include "../Simulation.h"
+#include "../SoftwareRenderer.h"
+#include "../stb_image.h"
+
+#include "../glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int GOLDEN_WIDTH = 320;
+constexpr int GOLDEN_HEIGHT = 240;
+constexpr char GOLDEN_DIRECTORY[] = "replays/golden";
+
+struct Scene
+{
+    const char* name;
+    const char* replay_filepath;   // nullptr for the start screen
+    uint64_t    steps;             // 0 plays the whole replay
+    FilterType  filter_type;
+};
+
+const Scene SCENES[] = {
+    { "start",          nullptr,                          0,   NEAREST },
+    { "thrust_bubbles", "replays/thrust_bubbles.replay",  400, NEAREST },
+    { "bubbles_linear", "replays/thrust_bubbles.replay",  400, LINEAR },
+    { "landing",        "replays/landing.replay",         0,   NEAREST },
+    { "crash",          "replays/crash.replay",           0,   NEAREST },
+};
+
+// every texture, once per filter type
+struct TextureSet
+{
+    GLuint ids[NUM_TEXTURE_ASSETS];
+};
+
+bool load_textures(SoftwareRenderer& renderer, TextureSet sets[2])
+{
+    return renderer.load_textures(NEAREST, sets[NEAREST].ids) && renderer.load_textures(LINEAR, sets[LINEAR].ids);
+}
+
+// the state the scene's frame draws
+bool play_scene(const Scene& scene, const TextureSet& textures, GameSnapshot& snapshot)
+{
+    GameState state = {};
+    InitialState initial;
+    build_level(state, initial, get_level_textures(textures.ids));
+
+    bool ok = true;
+    if (scene.replay_filepath != nullptr)
+    {
+        Replay replay;
+        ok = replay.load(scene.replay_filepath);
+        uint64_t steps = scene.steps == 0 ? replay.step_count : std::min(scene.steps, replay.step_count);
+        size_t cursor = 0;
+        for (uint64_t step = 0; ok && step < steps; step++)
+        {
+            SimInput input = replay.get_input(step, cursor);
+            apply_commands(state, initial, input);
+            step_simulation(state, input, 1.0f / replay.hz);
+        }
+    }
+    take_snapshot(state, snapshot);
+    free_game_state(state);
+    return ok;
+}
+
+// the scene's frame, as the game would draw it once play has stopped
+void render_scene(SoftwareRenderer& renderer, GLuint font_texture_id, const GameSnapshot& snapshot, FrameData& frame)
+{
+    build_frame(frame, snapshot, 1.0f);
+    renderer.begin_frame();
+    draw_frame(renderer, font_texture_id, frame);
+    renderer.end_frame();
+}
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+int main(int argc, char* argv[])
+{
+    bool update = false;
+    int threshold = 2;
+    int max_differing = 0;
+    int workers = (int)std::max(1u, std::thread::hardware_concurrency()) - 1;
+    int width = GOLDEN_WIDTH;
+    int height = GOLDEN_HEIGHT;
+    const char* out_directory = "golden_out";
+    int bench_frames = 0;
+    bool usage_error = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--update") == 0) update = true;
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--max-differing") == 0 && i + 1 < argc) max_differing = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) workers = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) width = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) height = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_directory = argv[++i];
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) bench_frames = std::max(1, atoi(argv[++i]));
+        else usage_error = true;
+    }
+
+    if (usage_error)
+    {
+        LOG("Usage: golden [--update] [--threshold N] [--max-differing N] [--workers N] [--width W] [--height H] [--out DIR] [--bench FRAMES]");
+        return 1;
+    }
+
+    // goldens only mean anything at the size they were made at
+    bool golden_size = width == GOLDEN_WIDTH && height == GOLDEN_HEIGHT;
+    if (update && !golden_size)
+    {
+        LOG("ERROR: golden images are " << GOLDEN_WIDTH << "x" << GOLDEN_HEIGHT << ", don't pass --width/--height with --update");
+        return 1;
+    }
+
+    SoftwareRenderer renderer;
+    renderer.set_projection_matrix(glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f));
+    renderer.set_view_matrix(glm::mat4(1.0f));
+    renderer.set_clear_colour(0.0f, 0.0f, 170.0f / 255.0f, 1.0f);
+    renderer.start(width, height, workers);
+
+    TextureSet textures[2];
+    if (!load_textures(renderer, textures))
+    {
+        renderer.shutdown();
+        return 1;
+    }
+
+    GameSnapshot* snapshot = new GameSnapshot();
+    FrameData* frame = new FrameData();
+    reserve_frame(*frame);
+    std::vector<uint32_t> golden;
+    bool failed = false;
+
+    LOG("Rendering " << width << "x" << height << " on " << workers + 1 << " threads");
+    if (bench_frames > 0)
+    {
+        printf("%-16s %9s %9s %9s %9s %11s\n", "scene", "triangles", "frame ms", "bin ms", "raster ms", "Mpixels/s");
+    }
+    for (const Scene& scene : SCENES)
+    {
+        const TextureSet& set = textures[scene.filter_type];
+        if (!play_scene(scene, set, *snapshot))
+        {
+            failed = true;
+            continue;
+        }
+        render_scene(renderer, set.ids[FONT_TEXTURE], *snapshot, *frame);
+
+        std::string golden_filepath = std::string(GOLDEN_DIRECTORY) + "/" + scene.name + ".ppm";
+        if (update)
+        {
+            if (!renderer.write_ppm(golden_filepath.c_str()))
+            {
+                LOG("ERROR: could not write " << golden_filepath);
+                failed = true;
+            }
+            else LOG(scene.name << ": updated " << golden_filepath);
+        }
+        else if (golden_size)
+        {
+            int golden_width, golden_height;
+            if (!read_ppm(golden_filepath.c_str(), golden, golden_width, golden_height)
+                || golden_width != width || golden_height != height)
+            {
+                LOG(scene.name << ": FAIL no usable golden image at " << golden_filepath);
+                failed = true;
+            }
+            else
+            {
+                ImageDiff diff = compare_images(renderer.get_pixels(), golden.data(), width * height, threshold);
+                bool scene_failed = diff.differing_pixels > max_differing;
+                LOG(scene.name << ": " << (scene_failed ? "FAIL " : "ok ") << diff.differing_pixels
+                    << " pixels differ, worst channel off by " << diff.max_difference);
+                if (scene_failed)
+                {
+                    std::string out_filepath = std::string(out_directory) + "/" + scene.name + ".ppm";
+                    if (renderer.write_ppm(out_filepath.c_str())) LOG("  wrote " << out_filepath);
+                    else LOG("  could not write " << out_filepath << ", does " << out_directory << " exist?");
+                    failed = true;
+                }
+            }
+        }
+
+        if (bench_frames > 0)
+        {
+            std::vector<double> frame_ms, bin_ms, raster_ms;
+            for (int i = 0; i < bench_frames; i++)
+            {
+                render_scene(renderer, set.ids[FONT_TEXTURE], *snapshot, *frame);
+                frame_ms.push_back(renderer.get_stats().frame_ms);
+                bin_ms.push_back(renderer.get_stats().bin_ms);
+                raster_ms.push_back(renderer.get_stats().raster_ms);
+            }
+            double frame = median(frame_ms);
+            // every pixel gets cleared and written, whether or not anything covers it
+            double mpixels = (double)width * height / (frame * 1000.0);
+            printf("%-16s %9d %9.3f %9.3f %9.3f %11.1f\n", scene.name, renderer.get_stats().triangles, frame,
+                median(bin_ms), median(raster_ms), mpixels);
+        }
+    }
+
+    delete frame;
+    delete snapshot;
+    renderer.shutdown();
+
+    if (failed) LOG("FAILED");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+// Turns a binary log (see BinaryLog.h, write one with the game's --log flag)
+// back into text, one line per record:
+//
+//     12.345678 [t1] velocity 0.0000 -0.2000 acceleration 0.0000 -0.2000
+//
+// seconds on the trace clock, the thread that logged it, then the formatted
+// record. Dropped records show up where the writer noticed them. A log that's
+// still being written, or was cut off by a crash, decodes up to its last whole
+// record.
+//
+// Usage: log_decode [--locations] [--thread N] [--grep TEXT] <file.binlog>
+//
+// --locations puts the file:line of the BINLOG call in front of each record,
+// --thread keeps only one thread's records and --grep only the lines
+// containing TEXT.
+
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "../BinaryLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Format
+{
+    std::string format;
+    std::string location;
+};
+
+bool read(FILE* file, void* data, size_t size)
+{
+    return fread(data, 1, size, file) == size;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* filepath = nullptr;
+    const char* grep = nullptr;
+    bool locations = false;
+    int only_thread = -1;
+    bool usage_error = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--locations") == 0) locations = true;
+        else if (strcmp(argv[i], "--thread") == 0 && i + 1 < argc) only_thread = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--grep") == 0 && i + 1 < argc) grep = argv[++i];
+        else if (argv[i][0] != '-' && filepath == nullptr) filepath = argv[i];
+        else usage_error = true;
+    }
+
+    if (usage_error || filepath == nullptr)
+    {
+        LOG("Usage: log_decode [--locations] [--thread N] [--grep TEXT] <file.binlog>");
+        return 1;
+    }
+
+    FILE* file = fopen(filepath, "rb");
+    if (file == nullptr)
+    {
+        LOG("Couldn't open " << filepath);
+        return 1;
+    }
+
+    uint32_t header[3];
+    if (!read(file, header, sizeof(header)) || header[0] != BinaryLog::FILE_MAGIC)
+    {
+        LOG(filepath << " isn't a binary log");
+        fclose(file);
+        return 1;
+    }
+    if (header[1] != BinaryLog::FILE_VERSION || header[2] != sizeof(LogRecord))
+    {
+        LOG(filepath << " is version " << header[1] << " with " << header[2] << " byte records, this reads version "
+            << BinaryLog::FILE_VERSION << " with " << sizeof(LogRecord));
+        fclose(file);
+        return 1;
+    }
+
+    std::vector<Format> formats;
+    std::string format;
+    uint64_t records = 0;
+    uint64_t dropped = 0;
+    char text[1024];
+    char line[1280];
+    bool truncated = false;
+
+    uint8_t kind;
+    while (read(file, &kind, 1))
+    {
+        if (kind == LOG_ENTRY_FORMAT)
+        {
+            uint32_t id, source_line;
+            uint16_t file_length, format_length;
+            if (!read(file, &id, 4) || !read(file, &source_line, 4) || !read(file, &file_length, 2)
+                || !read(file, &format_length, 2))
+            {
+                truncated = true;
+                break;
+            }
+
+            std::string source(file_length, '\0');
+            format.assign(format_length, '\0');
+            if ((file_length > 0 && !read(file, &source[0], file_length))
+                || (format_length > 0 && !read(file, &format[0], format_length)))
+            {
+                truncated = true;
+                break;
+            }
+            if (id >= formats.size()) formats.resize(id + 1);
+            formats[id].format = format;
+            formats[id].location = source + ":" + std::to_string(source_line);
+        }
+        else if (kind == LOG_ENTRY_RECORD)
+        {
+            LogRecord record;
+            if (!read(file, &record, sizeof(record)))
+            {
+                truncated = true;
+                break;
+            }
+            records++;
+            if (only_thread >= 0 && record.thread != only_thread) continue;
+
+            if (record.format_id < formats.size())
+            {
+                BinaryLog::format(formats[record.format_id].format.c_str(), record, text, sizeof(text));
+            }
+            else
+            {
+                snprintf(text, sizeof(text), "<unknown format %u>", record.format_id);
+            }
+            snprintf(line, sizeof(line), "%12.6f [t%u] %s%s%s", record.time_ns / 1e9, record.thread,
+                locations && record.format_id < formats.size() ? formats[record.format_id].location.c_str() : "",
+                locations ? " " : "", text);
+            if (grep == nullptr || strstr(line, grep) != nullptr) puts(line);
+        }
+        else if (kind == LOG_ENTRY_DROPPED)
+        {
+            uint32_t thread;
+            uint64_t count;
+            if (!read(file, &thread, 4) || !read(file, &count, 8))
+            {
+                truncated = true;
+                break;
+            }
+            dropped += count;
+            if (only_thread >= 0 && (int)thread != only_thread) continue;
+            printf("%12s [t%u] %llu records dropped\n", "", thread, (unsigned long long)count);
+        }
+        else
+        {
+            LOG("Unknown entry " << (int)kind << " at byte " << ftell(file) - 1 << ", stopping");
+            break;
+        }
+    }
+    fclose(file);
+
+    if (truncated) LOG("Last entry cut short, the log was still being written or didn't close");
+    fprintf(stderr, "%llu records, %llu dropped\n", (unsigned long long)records, (unsigned long long)dropped);
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Offline asset packer, turns the PNGs into a pack the game can mmap.
+//
+// Usage: pack_assets <output.pack> <image.png>...
+// Run it from the project root so the names stored in the pack match the
+// paths main.cpp asks for, e.g.
+//     pack_assets assets/assets.pack assets/*.png
+// The game stops using an entry once its PNG's size or modification time no
+// longer matches what was packed, so rerun it after editing any of them.
+
+#define STB_IMAGE_IMPLEMENTATION
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "../stb_image.h"
+#include "../AssetPack.h"
+#include "../TextureEncoding.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+struct PackedImage
+{
+    AssetPackEntry entry;
+    std::vector<unsigned char> pixels;
+};
+
+size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        LOG("Usage: pack_assets <output.pack> <image.png>...");
+        return 1;
+    }
+
+    std::vector<PackedImage> images;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strlen(argv[i]) >= ASSET_PACK_NAME_LENGTH)
+        {
+            LOG("ERROR: path too long for the pack index: " << argv[i]);
+            return 1;
+        }
+
+        uint64_t source_size;
+        int64_t source_modified;
+        if (!get_source_stamp(argv[i], source_size, source_modified))
+        {
+            LOG("ERROR: could not read " << argv[i]);
+            return 1;
+        }
+
+        int width, height, number_of_components;
+        unsigned char* image = stbi_load(argv[i], &width, &height, &number_of_components, STBI_rgb_alpha);
+        if (image == NULL)
+        {
+            LOG("ERROR: could not decode " << argv[i] << ": " << stbi_failure_reason());
+            return 1;
+        }
+
+        // everything is drawn with NEAREST so low colour formats are always fine
+        EncodedTexture texture;
+        encode_texture(image, width, height, true, texture);
+        stbi_image_free(image);
+
+        PackedImage packed = {};
+        strncpy(packed.entry.name, argv[i], ASSET_PACK_NAME_LENGTH - 1);
+        packed.entry.width = (uint32_t)width;
+        packed.entry.height = (uint32_t)height;
+        packed.entry.format = (uint32_t)texture.format;
+        packed.entry.palette_size = (uint32_t)texture.palette_size;
+        packed.entry.source_size = source_size;
+        packed.entry.source_modified = source_modified;
+        memcpy(packed.entry.palette, texture.palette, sizeof(packed.entry.palette));
+        packed.pixels = texture.pixels;
+
+        images.push_back(packed);
+    }
+
+    // lay out the data after the index, each blob aligned for the upload
+    size_t offset = sizeof(AssetPackHeader) + images.size() * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        offset = align_up(offset, ASSET_PACK_ALIGNMENT);
+        images[i].entry.offset = offset;
+        images[i].entry.size = images[i].pixels.size();
+        offset += images[i].pixels.size();
+    }
+
+    std::ofstream out(argv[1], std::ios::binary);
+    if (!out)
+    {
+        LOG("ERROR: could not open " << argv[1] << " for writing");
+        return 1;
+    }
+
+    AssetPackHeader header = { ASSET_PACK_MAGIC, ASSET_PACK_VERSION, (uint32_t)images.size(), 0 };
+    out.write((const char*)&header, sizeof(header));
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        out.write((const char*)&images[i].entry, sizeof(AssetPackEntry));
+    }
+
+    const char* FORMAT_NAMES[] = { "RGBA", "indexed", "1-bit mask" };
+    const char padding[ASSET_PACK_ALIGNMENT] = {};
+    size_t written = sizeof(AssetPackHeader) + images.size() * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        out.write(padding, images[i].entry.offset - written);
+        out.write((const char*)images[i].pixels.data(), images[i].pixels.size());
+        written = images[i].entry.offset + images[i].entry.size;
+
+        LOG(images[i].entry.name << ": " << images[i].entry.width << " x " << images[i].entry.height
+            << ", " << FORMAT_NAMES[images[i].entry.format] << ", " << images[i].entry.size << " bytes");
+    }
+
+    LOG("Wrote " << images.size() << " images, " << written << " bytes to " << argv[1]);
+    return 0;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+// Hardware performance counters around a block of code, read through Linux
+// perf_event_open. All counters go in one group so they're switched on and off
+// together and describe exactly the same instructions. If the kernel is
+// multiplexing the PMU the counts get scaled up by enabled/running time.
+//
+// Counters the CPU or VM doesn't have are skipped, and when none open at all
+// (no PMU in the container, perf_event_paranoid too strict, not Linux) open()
+// returns false and everything else quietly does nothing.
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum PerfCounter
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+class PerfCounters
+{
+public:
+    static const char* get_name(PerfCounter counter)
+    {
+        static const char* NAMES[PERF_COUNTER_COUNT] = {
+            "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+        };
+        return NAMES[counter];
+    }
+
+    ~PerfCounters() { close(); }
+
+#ifdef __linux__
+    bool open()
+    {
+        close();
+
+        // user space only, which is all paranoid level 2 allows anyway
+        const uint32_t TYPES[PERF_COUNTER_COUNT] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+        };
+        const uint64_t CONFIGS[PERF_COUNTER_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = TYPES[i];
+            attr.config = CONFIGS[i];
+            attr.disabled = m_leader == -1 ? 1 : 0;   // the leader switches the whole group
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0);
+            if (fd == -1) continue;
+
+            if (m_leader == -1) m_leader = fd;
+            m_fds[i] = fd;
+            ioctl(fd, PERF_EVENT_IOC_ID, &m_ids[i]);
+        }
+        return m_leader != -1;
+    }
+
+    void close()
+    {
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+        {
+            if (m_fds[i] != -1) ::close(m_fds[i]);
+            m_fds[i] = -1;
+            m_values[i] = 0.0;
+        }
+        m_leader = -1;
+    }
+
+    void start()
+    {
+        if (m_leader == -1) return;
+        ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    void stop()
+    {
+        if (m_leader == -1) return;
+        ioctl(m_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // nr, time enabled, time running, then a value and id per counter
+        uint64_t buffer[3 + 2 * PERF_COUNTER_COUNT];
+        if (read(m_leader, buffer, sizeof(buffer)) <= 0) return;
+
+        uint64_t count = buffer[0];
+        double scale = buffer[2] > 0 ? (double)buffer[1] / buffer[2] : 0.0;
+        for (uint64_t n = 0; n < count && n < PERF_COUNTER_COUNT; n++)
+        {
+            uint64_t value = buffer[3 + 2 * n];
+            uint64_t id = buffer[4 + 2 * n];
+            for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+            {
+                if (m_fds[i] != -1 && m_ids[i] == id) m_values[i] = value * scale;
+            }
+        }
+    }
+#else
+    bool open()  { return false; }
+    void close() {}
+    void start() {}
+    void stop()  {}
+#endif
+
+    bool const is_open() const                 { return m_leader != -1; }
+    bool const has(PerfCounter counter) const  { return m_fds[counter] != -1; }
+    // what the last start()/stop() counted
+    double const get(PerfCounter counter) const { return m_values[counter]; }
+
+private:
+    int      m_leader = -1;
+    int      m_fds[PERF_COUNTER_COUNT] = { -1, -1, -1, -1, -1 };
+    uint64_t m_ids[PERF_COUNTER_COUNT] = {};
+    double   m_values[PERF_COUNTER_COUNT] = {};
+};
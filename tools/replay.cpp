@@ -0,0 +1,415 @@
+// End to end performance regression runs. Plays recorded replays (see
+// Replay.h, record one with the game's --record flag) through the same update
+// path the game uses, timing every tick, and checks the timings against the
+// budgets stored next to the replays. No window, SDL or GPU needed.
+//
+// Usage: replay [--budgets FILE] [--update-budgets] [--tolerance PERCENT]
+//               [--repetitions N] [--frames] [--software-render] [--json FILE]
+//               [--telemetry FILE] [--alloc-strict] <file.replay>...
+//
+// A tick is apply_commands() + step_simulation() + take_snapshot(), and with
+// --frames also the CPU half of drawing the frame: build_frame() from Frame.h,
+// the same sprites, HUD and messages the game builds. --software-render goes
+// on to draw that frame with SoftwareRenderer at the game's window size, the
+// whole of a frame's cost with no GPU in the way.
+//
+// Every replay runs once to warm up and then --repetitions (9) more times, and
+// the median across those of each run's p50 and p99 tick time gets compared
+// against the budget. Anything more than --tolerance (25) percent
+// over fails the run, as does a replay that doesn't finish the way it was
+// recorded (landed, crashed...), since then it isn't timing what it says it is.
+//
+// --alloc-strict makes every timed tick a steady state frame for AllocTracker,
+// so the first one that allocates aborts the run with a report of where. It
+// needs a build with -DTRACK_ALLOCATIONS and AllocTracker.cpp, and is how the
+// update path (and the frame path with --frames) is kept allocation free.
+//
+// --telemetry FILE also writes every replay's warm up pass into a telemetry
+// file (see Telemetry.h), one run per replay, which is a quick way to get
+// telemetry without playing the game.
+//
+// Budgets are machine specific, rerun with --update-budgets on the machine the
+// numbers are meant for whenever a change is expected to move them.
+
+#define LOG(argument) std::cout << argument << '\n'
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "../AllocTracker.h"
+#include "../Frame.h"
+#include "../Replay.h"
+#include "../Simulation.h"
+#include "../SoftwareRenderer.h"
+#include "../Telemetry.h"
+#include "../stb_image.h"
+
+#include "../glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the game's window
+constexpr int SOFTWARE_WIDTH = 960;
+constexpr int SOFTWARE_HEIGHT = 720;
+
+struct Budget
+{
+    std::string name;
+    double      p50_us;
+    double      p99_us;
+};
+
+struct RunResult
+{
+    std::string name;
+    uint64_t    ticks;
+    double      mean_us;
+    double      p50_us;
+    double      p95_us;
+    double      p99_us;
+    double      max_us;
+    bool        status_ok;
+    EntityStatus final_status;
+};
+
+volatile float g_sink = 0.0f;
+
+// --software-render, every tick's frame gets drawn. Levels are built with
+// these so the sprites have something to sample, all 0 otherwise
+SoftwareRenderer g_renderer;
+bool g_software_render = false;
+GLuint g_texture_ids[NUM_TEXTURE_ASSETS] = {};
+
+// --telemetry, steps carry on from one replay to the next so they share blocks
+TelemetryWriter g_telemetry;
+uint64_t g_telemetry_step = 0;
+uint32_t g_telemetry_run = 0;
+
+// one full play through, tick times (in microseconds) appended to tick_us
+EntityStatus play(const Replay& replay, bool frames, FrameData& frame, GameSnapshot& snapshot,
+    std::vector<double>* tick_us, bool telemetry = false)
+{
+    GameState state = {};
+    InitialState initial;
+    build_level(state, initial, get_level_textures(g_texture_ids));
+
+    float delta_time = 1.0f / replay.hz;
+    size_t cursor = 0;
+    for (uint64_t step = 0; step < replay.step_count; step++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        AllocTracker::begin_frame();
+
+        SimInput input = replay.get_input(step, cursor);
+        apply_commands(state, initial, input);
+        EntityStatus status_before = state.ship->get_status();
+        step_simulation(state, input, delta_time);
+        take_snapshot(state, snapshot);
+        if (frames)
+        {
+            build_frame(frame, snapshot, 1.0f);
+            if (g_software_render)
+            {
+                g_renderer.begin_frame();
+                draw_frame(g_renderer, g_texture_ids[FONT_TEXTURE], frame);
+                g_renderer.end_frame();
+            }
+            else g_sink = g_sink + frame.sprites[frame.sprite_count - 1].model_matrix[3][0];
+        }
+        if (telemetry)
+        {
+            if (input.commands & COMMAND_RESET) g_telemetry_run++;
+            TelemetryTick tick;
+            fill_telemetry_tick(tick, state, input, status_before, g_telemetry_run);
+            g_telemetry.record(g_telemetry_step++, tick);
+        }
+
+        AllocTracker::end_frame();
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        if (tick_us != nullptr) tick_us->push_back(elapsed.count());
+    }
+
+    EntityStatus status = state.ship->get_status();
+    free_game_state(state);
+    if (telemetry) g_telemetry_run++;
+    return status;
+}
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+double percentile(const std::vector<double>& sorted, double percent)
+{
+    size_t rank = (size_t)(percent / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+std::string get_replay_name(const char* filepath, bool frames, bool software_render)
+{
+    std::string name = filepath;
+    size_t slash = name.find_last_of("/\\");
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos) name = name.substr(0, dot);
+    // the modes cost very different amounts so they get their own budgets
+    if (software_render) return name + ":software";
+    return frames ? name + ":frames" : name;
+}
+
+// "name p50_us p99_us" a line, # for comments
+std::vector<Budget> load_budgets(const char* filepath)
+{
+    std::vector<Budget> budgets;
+    FILE* file = fopen(filepath, "r");
+    if (file == nullptr) return budgets;
+
+    char line[256], name[128];
+    double p50, p99;
+    while (fgets(line, sizeof(line), file) != nullptr)
+    {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%127s %lf %lf", name, &p50, &p99) == 3) budgets.push_back({ name, p50, p99 });
+    }
+    fclose(file);
+    return budgets;
+}
+
+bool save_budgets(const char* filepath, const std::vector<Budget>& budgets)
+{
+    FILE* file = fopen(filepath, "w");
+    if (file == nullptr) return false;
+
+    fprintf(file, "# replay p50_us p99_us, per tick. Written by replay --update-budgets\n");
+    for (const Budget& budget : budgets)
+    {
+        fprintf(file, "%s %.2f %.2f\n", budget.name.c_str(), budget.p50_us, budget.p99_us);
+    }
+    fclose(file);
+    return true;
+}
+
+Budget* find_budget(std::vector<Budget>& budgets, const std::string& name)
+{
+    for (Budget& budget : budgets)
+    {
+        if (budget.name == name) return &budget;
+    }
+    return nullptr;
+}
+
+bool write_json(const char* filepath, const std::vector<RunResult>& results)
+{
+    FILE* file = fopen(filepath, "w");
+    if (file == nullptr) return false;
+
+    fprintf(file, "{\n  \"replays\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const RunResult& result = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"ticks\": %llu, \"mean_us\": %.3f, \"p50_us\": %.3f, "
+            "\"p95_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f, \"final_status\": \"%s\"}%s\n",
+            result.name.c_str(), (unsigned long long)result.ticks, result.mean_us, result.p50_us,
+            result.p95_us, result.p99_us, result.max_us, get_status_name(result.final_status),
+            i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* budgets_filepath = "replays/budgets.txt";
+    const char* json_filepath = nullptr;
+    const char* telemetry_filepath = nullptr;
+    bool update_budgets = false;
+    bool frames = false;
+    double tolerance = 25.0;
+    int repetitions = 9;
+    std::vector<const char*> replay_filepaths;
+    bool usage_error = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--budgets") == 0 && i + 1 < argc) budgets_filepath = argv[++i];
+        else if (strcmp(argv[i], "--update-budgets") == 0) update_budgets = true;
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = std::max(0.0, atof(argv[++i]));
+        else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) repetitions = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--frames") == 0) frames = true;
+        else if (strcmp(argv[i], "--software-render") == 0) g_software_render = frames = true;
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_filepath = argv[++i];
+        else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) telemetry_filepath = argv[++i];
+        else if (strcmp(argv[i], "--alloc-strict") == 0) AllocTracker::set_strict(true);
+        else if (argv[i][0] != '-') replay_filepaths.push_back(argv[i]);
+        else usage_error = true;
+    }
+
+    if (usage_error || replay_filepaths.empty())
+    {
+        LOG("Usage: replay [--budgets FILE] [--update-budgets] [--tolerance PERCENT] [--repetitions N] [--frames] [--software-render] [--json FILE] [--telemetry FILE] [--alloc-strict] <file.replay>...");
+        return 1;
+    }
+    if (AllocTracker::is_strict() && !AllocTracker::is_tracking())
+    {
+        LOG("--alloc-strict needs a build with -DTRACK_ALLOCATIONS and AllocTracker.cpp");
+        return 1;
+    }
+
+    if (g_software_render)
+    {
+        int workers = (int)std::max(1u, std::thread::hardware_concurrency()) - 1;
+        g_renderer.set_projection_matrix(glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f));
+        g_renderer.set_view_matrix(glm::mat4(1.0f));
+        g_renderer.set_clear_colour(0.0f, 0.0f, 170.0f / 255.0f, 1.0f);
+        g_renderer.start(SOFTWARE_WIDTH, SOFTWARE_HEIGHT, workers);
+        if (!g_renderer.load_textures(NEAREST, g_texture_ids))
+        {
+            g_renderer.shutdown();
+            return 1;
+        }
+        LOG("Drawing every tick " << SOFTWARE_WIDTH << "x" << SOFTWARE_HEIGHT << " on " << workers + 1 << " threads");
+    }
+
+    std::vector<Budget> budgets = load_budgets(budgets_filepath);
+    std::vector<RunResult> results;
+    FrameData* frame = new FrameData();
+    reserve_frame(*frame);
+    GameSnapshot* snapshot = new GameSnapshot();
+    bool failed = false;
+
+    printf("%-24s %8s %9s %9s %9s %9s %9s  %s\n", "replay", "ticks", "mean us", "p50 us", "p95 us", "p99 us", "max us", "verdict");
+    for (const char* filepath : replay_filepaths)
+    {
+        Replay replay;
+        if (!replay.load(filepath))
+        {
+            failed = true;
+            continue;
+        }
+
+        RunResult result;
+        result.name = get_replay_name(filepath, frames, g_software_render);
+
+        if (telemetry_filepath != nullptr && !g_telemetry.is_open())
+        {
+            // the header wants the level's platforms, which only a built level has
+            GameState state = {};
+            InitialState initial;
+            build_level(state, initial, LevelTextures());
+            if (!g_telemetry.open(telemetry_filepath, replay.hz, *state.ship, state.platforms, NUM_PLATFORMS))
+            {
+                LOG("Couldn't open " << telemetry_filepath);
+                telemetry_filepath = nullptr;
+            }
+            free_game_state(state);
+        }
+        // the warm up pass grows every reused buffer to size, after it nothing should allocate
+        AllocTracker::set_steady_state(false);
+        play(replay, frames, *frame, *snapshot, nullptr, g_telemetry.is_open());
+        AllocTracker::set_steady_state(true);
+
+        // percentiles per repetition, then the median of each across them, so
+        // one repetition the OS got in the way of can't drag the numbers around
+        std::vector<double> tick_us;
+        std::vector<double> means, p50s, p95s, p99s;
+        tick_us.reserve(replay.step_count);
+        result.status_ok = true;
+        result.max_us = 0.0;
+        for (int i = 0; i < repetitions; i++)
+        {
+            tick_us.clear();
+            result.final_status = play(replay, frames, *frame, *snapshot, &tick_us);
+            if (replay.has_expected_status && result.final_status != replay.expected_status) result.status_ok = false;
+            if (tick_us.empty()) tick_us.push_back(0.0);
+
+            double total = 0.0;
+            for (double us : tick_us) total += us;
+            means.push_back(total / tick_us.size());
+            std::sort(tick_us.begin(), tick_us.end());
+            p50s.push_back(percentile(tick_us, 50.0));
+            p95s.push_back(percentile(tick_us, 95.0));
+            p99s.push_back(percentile(tick_us, 99.0));
+            result.max_us = std::max(result.max_us, tick_us.back());
+        }
+
+        result.ticks = replay.step_count;
+        result.mean_us = median(means);
+        result.p50_us = median(p50s);
+        result.p95_us = median(p95s);
+        result.p99_us = median(p99s);
+        results.push_back(result);
+
+        std::string verdict;
+        Budget* budget = find_budget(budgets, result.name);
+        if (!result.status_ok)
+        {
+            verdict = std::string("FAIL ended ") + get_status_name(result.final_status) + ", recorded "
+                + get_status_name(replay.expected_status);
+            failed = true;
+        }
+        else if (update_budgets)
+        {
+            if (budget == nullptr)
+            {
+                budgets.push_back({ result.name, 0.0, 0.0 });
+                budget = &budgets.back();
+            }
+            budget->p50_us = result.p50_us;
+            budget->p99_us = result.p99_us;
+            verdict = "budget updated";
+        }
+        else if (budget == nullptr)
+        {
+            verdict = "no budget";
+        }
+        else
+        {
+            double limit = 1.0 + tolerance / 100.0;
+            bool p50_over = result.p50_us > budget->p50_us * limit;
+            bool p99_over = result.p99_us > budget->p99_us * limit;
+            char text[128];
+            snprintf(text, sizeof(text), "%s p50 %+.0f%% p99 %+.0f%%", p50_over || p99_over ? "FAIL" : "ok",
+                100.0 * (result.p50_us / budget->p50_us - 1.0), 100.0 * (result.p99_us / budget->p99_us - 1.0));
+            verdict = text;
+            if (p50_over || p99_over) failed = true;
+        }
+
+        printf("%-24s %8llu %9.2f %9.2f %9.2f %9.2f %9.2f  %s\n", result.name.c_str(),
+            (unsigned long long)result.ticks, result.mean_us, result.p50_us, result.p95_us, result.p99_us,
+            result.max_us, verdict.c_str());
+    }
+
+    delete frame;
+    delete snapshot;
+    if (g_software_render) g_renderer.shutdown();
+
+    if (g_telemetry.is_open())
+    {
+        g_telemetry.close();
+        LOG("Wrote " << g_telemetry.get_ticks() << " steps over " << g_telemetry_run << " runs to " << telemetry_filepath);
+    }
+
+    if (update_budgets && !save_budgets(budgets_filepath, budgets))
+    {
+        LOG("ERROR: could not write " << budgets_filepath);
+        return 1;
+    }
+    if (json_filepath != nullptr && !write_json(json_filepath, results))
+    {
+        LOG("ERROR: could not write " << json_filepath);
+        return 1;
+    }
+
+    if (failed) LOG("FAILED, more than " << tolerance << "% over budget or a replay didn't finish as recorded");
+    return failed ? 1 : 0;
+}
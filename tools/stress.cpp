@@ -0,0 +1,355 @@
+// Stress scenarios: as many landers, sharks and platforms as you like, all
+// stepped with the game's own update code, to see how the cost of a tick
+// grows before anything ships with more than one lander or a generated level.
+//
+// Usage: stress [--ships N] [--sharks N] [--platforms N] [--ticks N]
+//               [--sweep MAX] [--seed N] [--csv FILE]
+//
+// Every ship flies a script: turn upright, then hover towards a target height
+// that keeps changing, the way a player hangs around waiting to land. Ships
+// that crash or land respawn straight away so N really is N the whole run,
+// somewhere up top with some room around it from every platform and shark, so
+// a ship can't come back inside a passing shark and crash again every tick.
+// Ships don't collide with each other (the game has no rules for that), each
+// one checks every platform and shark, so update should come out roughly
+// ships * (platforms + sharks).
+//
+// --sweep MAX reruns the scenario with every count multiplied by 1, 2, 4 and
+// so on up to MAX and prints how each step compares to the last one: the
+// exponent column is log2 of the growth, so 1 is linear and 2 is quadratic.
+// Render here is the CPU side of a frame (building every sprite), nothing
+// headless can time the GL side.
+
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "../Simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+constexpr float FIXED_TIMESTEP = 1.0f / 60.0f;
+constexpr int WARMUP_TICKS = 120;
+constexpr int MAX_SPAWN_ATTEMPTS = 32;  // a packed level may have nowhere clear, then the last try stands
+constexpr float SPAWN_CLEARANCE = 0.5f; // around the ship, about a second of the fastest shark
+
+// a hover with a target height that moves every few seconds
+struct ShipScript
+{
+    float    target_height;
+    int      ticks_left;     // until a new target
+    uint32_t random;
+};
+
+struct StressWorld
+{
+    std::vector<Entity>     ships;
+    std::vector<Entity>     spawns;       // what each ship goes back to
+    std::vector<ShipScript> scripts;
+    std::vector<Entity>     obstacles;    // landable platforms, then sharks
+    std::vector<Entity*>    bubbles;
+    std::vector<Entity*>    bubble_pool;
+    std::vector<SpriteDraw> sprites;
+    uint64_t                respawns = 0;
+};
+
+struct StressResult
+{
+    int    ships;
+    int    sharks;
+    int    platforms;
+    double update_p50_us;
+    double update_p99_us;
+    double render_p50_us;
+    double bubbles;            // average alive
+    double respawns_per_second;
+};
+
+volatile float g_sink = 0.0f;
+
+// xorshift, so a seed always gives the same scenario
+uint32_t next_random(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+float random_range(uint32_t& state, float low, float high)
+{
+    return low + (high - low) * (next_random(state) & 0xffff) / 65535.0f;
+}
+
+bool overlaps_obstacle(const Entity& ship, std::vector<Entity>& obstacles)
+{
+    // the ship with SPAWN_CLEARANCE all the way round
+    Entity probe = ship;
+    glm::vec3 scale = ship.get_scale();
+    probe.set_dimensions(scale.x + 2.0f * SPAWN_CLEARANCE, scale.y + 2.0f * SPAWN_CLEARANCE);
+    for (Entity& obstacle : obstacles)
+    {
+        if (probe.check_collision_SAT(&obstacle)) return true;
+    }
+    return false;
+}
+
+// moves the ship around the spawn band until it's clear, drawing from the
+// ship's own random stream so a seed still always gives the same run
+void place_clear(Entity& ship, std::vector<Entity>& obstacles, uint32_t& random)
+{
+    for (int attempt = 0; attempt < MAX_SPAWN_ATTEMPTS && overlaps_obstacle(ship, obstacles); attempt++)
+    {
+        ship.set_position(glm::vec3(random_range(random, -4.5f, 4.5f), random_range(random, 1.5f, 3.5f), 1.0f));
+        ship.update(0.0f, nullptr, 0);
+    }
+}
+
+void build_world(StressWorld& world, int ships, int sharks, int platforms, uint32_t seed)
+{
+    // start from the real level so sizes, speeds and flags all match the game
+    GameState level = {};
+    InitialState initial;
+    build_level(level, initial, LevelTextures());
+    free_game_state(level);
+
+    uint32_t random = seed;
+    for (int i = 0; i < platforms; i++)
+    {
+        // alternate castles and towers along the sea floor
+        Entity platform = initial.platforms[i % 2 == 0 ? 0 : 2];
+        platform.set_position(glm::vec3(random_range(random, -4.5f, 4.5f), -3.2f, 1.0f));
+        platform.update(0.0f, nullptr, 0);
+        world.obstacles.push_back(platform);
+    }
+    for (int i = 0; i < sharks; i++)
+    {
+        Entity shark = initial.platforms[1];
+        shark.set_position(glm::vec3(random_range(random, -6.0f, 6.0f), random_range(random, -2.0f, 1.5f), 1.0f));
+        shark.set_movement(glm::vec3(random_range(random, -0.8f, -0.3f), 0.0f, 0.0f));
+        shark.update(0.0f, nullptr, 0);
+        world.obstacles.push_back(shark);
+    }
+    for (int i = 0; i < ships; i++)
+    {
+        Entity ship = initial.ship;
+        ship.set_status(ACTIVE);
+        ship.set_position(glm::vec3(random_range(random, -4.5f, 4.5f), random_range(random, 1.5f, 3.5f), 1.0f));
+        ship.update(0.0f, nullptr, 0);
+        ShipScript script = { 2.5f, 0, next_random(random) | 1 };
+        place_clear(ship, world.obstacles, script.random);
+
+        world.ships.push_back(ship);
+        world.spawns.push_back(ship);
+        world.scripts.push_back(script);
+    }
+
+    // a ship spawns a bubble every 20 steps of thrust and each lives for 7 seconds
+    world.bubbles.reserve(ships * 24 + MAX_BUBBLES);
+    world.bubble_pool.reserve(ships * 24 + MAX_BUBBLES);
+    world.sprites.reserve(world.obstacles.size() + world.ships.size() + world.bubbles.capacity());
+}
+
+void free_world(StressWorld& world)
+{
+    for (Entity* bubble : world.bubbles) delete bubble;
+    for (Entity* bubble : world.bubble_pool) delete bubble;
+    world.bubbles.clear();
+    world.bubble_pool.clear();
+}
+
+SimInput run_script(ShipScript& script, const Entity& ship)
+{
+    if (script.ticks_left-- <= 0)
+    {
+        script.target_height = random_range(script.random, -1.5f, 3.5f);
+        script.ticks_left = 120 + next_random(script.random) % 240;
+    }
+
+    SimInput input = {};
+    float angle = ship.get_angle();
+    if (angle < 89.0f) input.angle_dir = LEFT;
+    else if (angle > 91.0f) input.angle_dir = RIGHT;
+    else input.angle_dir = NONE;
+
+    // thrust whenever it's falling faster than it wants to
+    float wanted_velocity = (script.target_height - ship.get_position().y) * 0.8f;
+    input.using_fuel = ship.get_velocity().y < wanted_velocity;
+    return input;
+}
+
+void update_world(StressWorld& world)
+{
+    for (Entity& obstacle : world.obstacles) obstacle.store_previous_transform();
+    for (Entity& ship : world.ships) ship.store_previous_transform();
+    for (Entity* bubble : world.bubbles) bubble->store_previous_transform();
+
+    for (Entity& obstacle : world.obstacles)
+    {
+        obstacle.update(FIXED_TIMESTEP, nullptr, 0);
+    }
+    update_bubbles(world.bubbles, world.bubble_pool, FIXED_TIMESTEP);
+
+    for (size_t i = 0; i < world.ships.size(); i++)
+    {
+        Entity& ship = world.ships[i];
+        if (ship.get_status() != ACTIVE)
+        {
+            // the sharks have moved on since the spawn was picked
+            ship = world.spawns[i];
+            place_clear(ship, world.obstacles, world.scripts[i].random);
+            world.respawns++;
+        }
+        if (ship.get_fuel() < 100) ship.set_fuel(1000);
+
+        SimInput input = run_script(world.scripts[i], ship);
+        update_lander(ship, input, world.obstacles.data(), (int)world.obstacles.size(),
+            world.bubbles, world.bubble_pool, 0, FIXED_TIMESTEP);
+    }
+}
+
+void render_world(StressWorld& world)
+{
+    world.sprites.clear();
+    SpriteDraw sprite;
+    for (const Entity& obstacle : world.obstacles)
+    {
+        Entity::build_sprite(obstacle.get_snapshot(), 1.0f, sprite);
+        world.sprites.push_back(sprite);
+    }
+    for (const Entity* bubble : world.bubbles)
+    {
+        Entity::build_sprite(bubble->get_snapshot(), 1.0f, sprite);
+        world.sprites.push_back(sprite);
+    }
+    for (const Entity& ship : world.ships)
+    {
+        Entity::build_sprite(ship.get_snapshot(), 1.0f, sprite);
+        world.sprites.push_back(sprite);
+    }
+    if (!world.sprites.empty()) g_sink = g_sink + world.sprites.back().model_matrix[3][0];
+}
+
+double get_percentile(std::vector<double>& values, double percent)
+{
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(percent / 100.0 * (values.size() - 1) + 0.5)];
+}
+
+StressResult run_scenario(int ships, int sharks, int platforms, int ticks, uint32_t seed)
+{
+    StressWorld world;
+    build_world(world, ships, sharks, platforms, seed);
+
+    std::vector<double> update_us, render_us;
+    update_us.reserve(ticks);
+    render_us.reserve(ticks);
+    double bubble_total = 0.0;
+
+    for (int tick = 0; tick < WARMUP_TICKS + ticks; tick++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        update_world(world);
+        auto updated = std::chrono::steady_clock::now();
+        render_world(world);
+        auto rendered = std::chrono::steady_clock::now();
+
+        if (tick == WARMUP_TICKS) world.respawns = 0;
+        if (tick < WARMUP_TICKS) continue;
+
+        update_us.push_back(std::chrono::duration<double, std::micro>(updated - start).count());
+        render_us.push_back(std::chrono::duration<double, std::micro>(rendered - updated).count());
+        bubble_total += world.bubbles.size();
+    }
+
+    StressResult result;
+    result.ships = ships;
+    result.sharks = sharks;
+    result.platforms = platforms;
+    result.update_p50_us = get_percentile(update_us, 50.0);
+    result.update_p99_us = get_percentile(update_us, 99.0);
+    result.render_p50_us = get_percentile(render_us, 50.0);
+    result.bubbles = bubble_total / ticks;
+    result.respawns_per_second = world.respawns / (ticks * FIXED_TIMESTEP);
+
+    free_world(world);
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    int ships = 1;
+    int sharks = 1;
+    int platforms = 2;
+    int ticks = 600;
+    int sweep = 0;
+    uint32_t seed = 12345;
+    const char* csv_filepath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--ships") == 0 && i + 1 < argc) ships = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--sharks") == 0 && i + 1 < argc) sharks = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--platforms") == 0 && i + 1 < argc) platforms = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) ticks = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) sweep = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (uint32_t)std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csv_filepath = argv[++i];
+        else
+        {
+            LOG("Usage: stress [--ships N] [--sharks N] [--platforms N] [--ticks N] [--sweep MAX] [--seed N] [--csv FILE]");
+            return 1;
+        }
+    }
+
+    std::vector<int> scales;
+    for (int scale = 1; scale <= std::max(1, sweep); scale *= 2) scales.push_back(scale);
+
+    FILE* csv = nullptr;
+    if (csv_filepath != nullptr)
+    {
+        csv = fopen(csv_filepath, "w");
+        if (csv == nullptr)
+        {
+            LOG("ERROR: could not write " << csv_filepath);
+            return 1;
+        }
+        fprintf(csv, "ships,sharks,platforms,update_p50_us,update_p99_us,render_p50_us,bubbles,respawns_per_second\n");
+    }
+
+    printf("%6s %6s %9s %12s %12s %12s %8s %9s %9s %9s\n", "ships", "sharks", "platforms", "update p50",
+        "update p99", "render p50", "bubbles", "respawn/s", "update ^", "render ^");
+
+    StressResult previous = {};
+    for (size_t i = 0; i < scales.size(); i++)
+    {
+        StressResult result = run_scenario(ships * scales[i], sharks * scales[i], platforms * scales[i], ticks, seed);
+
+        // growth against the previous row, which had half of everything
+        char update_exponent[16] = "-", render_exponent[16] = "-";
+        if (i > 0 && previous.update_p50_us > 0.0 && previous.render_p50_us > 0.0)
+        {
+            snprintf(update_exponent, sizeof(update_exponent), "%.2f", log2(result.update_p50_us / previous.update_p50_us));
+            snprintf(render_exponent, sizeof(render_exponent), "%.2f", log2(result.render_p50_us / previous.render_p50_us));
+        }
+
+        printf("%6d %6d %9d %12.2f %12.2f %12.2f %8.1f %9.1f %9s %9s\n", result.ships, result.sharks,
+            result.platforms, result.update_p50_us, result.update_p99_us, result.render_p50_us,
+            result.bubbles, result.respawns_per_second, update_exponent, render_exponent);
+        if (csv != nullptr)
+        {
+            fprintf(csv, "%d,%d,%d,%.3f,%.3f,%.3f,%.2f,%.2f\n", result.ships, result.sharks, result.platforms,
+                result.update_p50_us, result.update_p99_us, result.render_p50_us, result.bubbles,
+                result.respawns_per_second);
+        }
+        previous = result;
+    }
+
+    if (csv != nullptr) fclose(csv);
+    return 0;
+}
@@ -0,0 +1,520 @@
+// Landing statistics over recorded telemetry (see Telemetry.h, record it with
+// the game's or tools/replay.cpp's --telemetry flag), for rebalancing where
+// the platforms go. Any number of files, each can still be being written.
+//
+// Usage: telemetry [--workers N] [--grid W H] [--grid-csv FILE] [--bench N] <file.telemetry>...
+//
+// A touchdown is the step a ship goes from ACTIVE to LANDED or CRASHED. For
+// every one it counts landings per platform and, the way valid_collision()
+// judges them, the approach speed (taken from the step before, the collision
+// zeroes the velocity before it's checked), the angle error and the fuel left.
+// Crashes also go into a --grid (40 x 30) density map over the play area,
+// printed as ASCII and written as CSV with --grid-csv.
+//
+// Blocks are split between --workers (all cores by default) on a task graph.
+// Finding touchdowns and counting active and thrusting steps runs down the
+// status and thrust columns sixteen steps at a time with SSE2, the other
+// columns are only read at the few steps that matter. --bench N repeats the
+// scan N times and prints the median time and steps per second.
+
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "../Telemetry.h"
+#include "../TaskGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define TELEMETRY_SSE2 1
+#endif
+
+// what the game shows, main.cpp's projection
+constexpr float WORLD_LEFT = -5.0f;
+constexpr float WORLD_RIGHT = 5.0f;
+constexpr float WORLD_BOTTOM = -3.75f;
+constexpr float WORLD_TOP = 3.75f;
+
+// valid_collision()'s limits
+constexpr float SPEED_LIMIT = 0.7f;
+constexpr int   ANGLE_LIMIT = 10;
+
+// the last bin of each catches everything past the end
+constexpr int   SPEED_BINS = 25;
+constexpr float SPEED_BIN_WIDTH = 0.05f;
+constexpr int   ANGLE_BINS = 31;
+constexpr int   ANGLE_BIN_WIDTH = 1;
+constexpr int   FUEL_BINS = 21;
+constexpr int   FUEL_BIN_WIDTH = 50;
+
+constexpr int TASKS_PER_THREAD = 4;     // smaller pieces so one slow file can't hold up the rest
+
+// in the order valid_collision() checks them, the first one that fails is the reason
+enum CrashReason { CRASH_OUT_OF_BOUNDS, CRASH_ENEMY, CRASH_EDGE, CRASH_ANGLE, CRASH_SPEED, CRASH_REASON_COUNT };
+const char* const CRASH_REASON_NAMES[CRASH_REASON_COUNT] = {
+    "out of bounds", "hit an enemy", "off the edge", "angle", "too fast"
+};
+
+struct Stats
+{
+    uint64_t ticks;
+    uint64_t active_ticks;
+    uint64_t thrust_ticks;                          // thrusting while ACTIVE
+    uint64_t landings;
+    uint64_t crashes;
+    uint64_t fast_landings;                         // would have failed the speed check if it ran on the real speed
+    uint64_t crash_reasons[CRASH_REASON_COUNT];
+    uint64_t touchdowns[TELEMETRY_MAX_PLATFORMS + 1];   // the last one is no platform at all
+    uint64_t platform_landings[TELEMETRY_MAX_PLATFORMS + 1];
+    uint64_t speed_x[2][SPEED_BINS];                // [landed] by |velocity.x|
+    uint64_t speed_y[2][SPEED_BINS];
+    uint64_t angle_error[2][ANGLE_BINS];
+    uint64_t fuel[2][FUEL_BINS];
+};
+
+// one step's values from every column
+struct Row
+{
+    float   position_x, position_y;
+    float   velocity_x, velocity_y;
+    float   angle;
+    int32_t fuel;
+    uint8_t status;
+    uint8_t contact;
+};
+
+struct Unit
+{
+    const TelemetryReader* reader;
+    uint64_t               block;
+};
+
+struct ScanTask
+{
+    const Unit*           units;
+    size_t                unit_count;
+    int                   grid_width;
+    int                   grid_height;
+    Stats                 stats;
+    std::vector<uint64_t> crash_grid;               // sized up front, row 0 at the bottom
+};
+
+Row get_row(const TelemetryBlock& block, uint32_t i)
+{
+    Row row;
+    row.position_x = block.position_x[i];
+    row.position_y = block.position_y[i];
+    row.velocity_x = block.velocity_x[i];
+    row.velocity_y = block.velocity_y[i];
+    row.angle = block.angle[i];
+    row.fuel = block.fuel[i];
+    row.status = block.status[i];
+    row.contact = block.contact[i];
+    return row;
+}
+
+int get_bin(float value, float width, int bins)
+{
+    int bin = (int)(value / width);
+    return bin < 0 ? 0 : bin >= bins ? bins - 1 : bin;
+}
+
+// the same sum valid_collision() does
+int get_angle_error(float angle)
+{
+    return abs(int(angle) % 360 - 90);
+}
+
+// valid_collision() wants the ship's box, turned by its angle, inside the
+// platform's left and right ends. Platforms that can be landed on never move
+// or turn, so where the header has them is where they are
+bool is_over_edge(const TelemetryFileHeader& header, const TelemetryPlatform& platform, const Row& row)
+{
+    float radians = row.angle * 3.14159265f / 180.0f;
+    float half_extent = fabsf(cosf(radians)) * header.ship_width / 2.0f
+        + fabsf(sinf(radians)) * header.ship_height / 2.0f;
+    return row.position_x - half_extent < platform.x - platform.width / 2.0f
+        || row.position_x + half_extent > platform.x + platform.width / 2.0f;
+}
+
+// ----- SCANNING ----- //
+// rows in [0, count) with status == ACTIVE, and with thrust as well
+void count_active(const uint8_t* status, const uint8_t* thrust, uint32_t count, uint64_t& active, uint64_t& thrusting)
+{
+    uint32_t i = 0;
+#ifdef TELEMETRY_SSE2
+    const __m128i active_status = _mm_set1_epi8((char)ACTIVE);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i active_sum = zero;
+    __m128i thrust_sum = zero;
+    for (; i + 16 <= count; i += 16)
+    {
+        // 0xFF where active, turned into ones and summed eight bytes at a time
+        __m128i is_active = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(status + i)), active_status);
+        __m128i is_thrusting = _mm_and_si128(is_active, _mm_loadu_si128((const __m128i*)(thrust + i)));
+        active_sum = _mm_add_epi64(active_sum, _mm_sad_epu8(_mm_and_si128(is_active, one), zero));
+        thrust_sum = _mm_add_epi64(thrust_sum, _mm_sad_epu8(_mm_and_si128(is_thrusting, one), zero));
+    }
+    active += (uint64_t)_mm_cvtsi128_si32(active_sum) + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(active_sum, 8));
+    thrusting += (uint64_t)_mm_cvtsi128_si32(thrust_sum) + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(thrust_sum, 8));
+#endif
+    for (; i < count; i++)
+    {
+        bool is_active = status[i] == ACTIVE;
+        active += is_active;
+        thrusting += is_active && thrust[i] != 0;
+    }
+}
+
+void add_touchdown(ScanTask& task, const TelemetryFileHeader& header, const Row& before, const Row& row)
+{
+    Stats& stats = task.stats;
+    int landed = row.status == LANDED ? 1 : 0;
+    int platform = row.contact < header.platform_count ? row.contact : TELEMETRY_MAX_PLATFORMS;
+
+    stats.touchdowns[platform]++;
+    stats.platform_landings[platform] += landed;
+    stats.speed_x[landed][get_bin(fabsf(before.velocity_x), SPEED_BIN_WIDTH, SPEED_BINS)]++;
+    stats.speed_y[landed][get_bin(fabsf(before.velocity_y), SPEED_BIN_WIDTH, SPEED_BINS)]++;
+    stats.angle_error[landed][get_bin((float)get_angle_error(row.angle), (float)ANGLE_BIN_WIDTH, ANGLE_BINS)]++;
+    stats.fuel[landed][get_bin((float)row.fuel, (float)FUEL_BIN_WIDTH, FUEL_BINS)]++;
+
+    if (landed)
+    {
+        stats.landings++;
+        if (fabsf(before.velocity_x) >= SPEED_LIMIT || fabsf(before.velocity_y) >= SPEED_LIMIT) stats.fast_landings++;
+        return;
+    }
+
+    stats.crashes++;
+    CrashReason reason;
+    if (platform == TELEMETRY_MAX_PLATFORMS) reason = CRASH_OUT_OF_BOUNDS;
+    else if (header.platforms[platform].enemy) reason = CRASH_ENEMY;
+    else if (is_over_edge(header, header.platforms[platform], row)) reason = CRASH_EDGE;
+    else if (get_angle_error(row.angle) > ANGLE_LIMIT) reason = CRASH_ANGLE;
+    else reason = CRASH_SPEED;
+    stats.crash_reasons[reason]++;
+
+    int x = (int)floorf((row.position_x - WORLD_LEFT) / (WORLD_RIGHT - WORLD_LEFT) * task.grid_width);
+    int y = (int)floorf((row.position_y - WORLD_BOTTOM) / (WORLD_TOP - WORLD_BOTTOM) * task.grid_height);
+    x = std::min(std::max(x, 0), task.grid_width - 1);
+    y = std::min(std::max(y, 0), task.grid_height - 1);
+    task.crash_grid[(size_t)y * task.grid_width + x]++;
+}
+
+// step i's status differs from the one before, see if it's a touchdown
+void check_change(ScanTask& task, const TelemetryFileHeader& header, const TelemetryBlock& block, uint32_t i,
+    const Row& carried)
+{
+    uint8_t status = block.status[i];
+    if (status != LANDED && status != CRASHED) return;
+
+    Row before = i == 0 ? carried : get_row(block, i - 1);
+    if (before.status != ACTIVE) return;
+    add_touchdown(task, header, before, get_row(block, i));
+}
+
+void scan_block(ScanTask& task, const TelemetryReader& reader, uint64_t index)
+{
+    const TelemetryFileHeader& header = *reader.get_header();
+    TelemetryBlock block = reader.get_block(index);
+    uint32_t count = block.tick_count;
+    if (count == 0) return;
+
+    task.stats.ticks += count;
+    count_active(block.status, block.thrust, count, task.stats.active_ticks, task.stats.thrust_ticks);
+
+    // the first step carries on from the end of the block before, if there's
+    // no gap between them
+    if (index > 0)
+    {
+        TelemetryBlock previous = reader.get_block(index - 1);
+        if (previous.tick_count > 0 && previous.first_step + previous.tick_count == block.first_step)
+        {
+            Row carried = get_row(previous, previous.tick_count - 1);
+            if (carried.status != block.status[0]) check_change(task, header, block, 0, carried);
+        }
+    }
+
+    Row none = {};
+    uint32_t i = 1;
+#ifdef TELEMETRY_SSE2
+    // compare sixteen statuses with the sixteen before them, nearly always all equal
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i current = _mm_loadu_si128((const __m128i*)(block.status + i));
+        __m128i previous = _mm_loadu_si128((const __m128i*)(block.status + i - 1));
+        unsigned changed = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(current, previous)) & 0xFFFF;
+        while (changed != 0)
+        {
+            int bit = 0;
+            while (!(changed & (1u << bit))) bit++;
+            changed &= changed - 1;
+            check_change(task, header, block, i + bit, none);
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        if (block.status[i] != block.status[i - 1]) check_change(task, header, block, i, none);
+    }
+}
+
+void scan_task(void* data)
+{
+    ScanTask& task = *(ScanTask*)data;
+    memset(&task.stats, 0, sizeof(task.stats));
+    std::fill(task.crash_grid.begin(), task.crash_grid.end(), 0);
+    for (size_t i = 0; i < task.unit_count; i++)
+    {
+        scan_block(task, *task.units[i].reader, task.units[i].block);
+    }
+}
+
+// ----- REPORT ----- //
+void merge(Stats& total, const Stats& stats)
+{
+    // nothing but counters, so it adds up as one flat array
+    uint64_t* into = (uint64_t*)&total;
+    const uint64_t* from = (const uint64_t*)&stats;
+    for (size_t i = 0; i < sizeof(Stats) / sizeof(uint64_t); i++) into[i] += from[i];
+}
+
+double percent(uint64_t part, uint64_t whole)
+{
+    return whole == 0 ? 0.0 : 100.0 * part / whole;
+}
+
+// landed and crashed side by side, a line at the limit if there is one
+void print_histogram(const char* title, const uint64_t* landed, const uint64_t* crashed, int bin_count,
+    double bin_width, double limit, int decimals)
+{
+    uint64_t most = 1;
+    for (int i = 0; i < bin_count; i++) most = std::max(most, std::max(landed[i], crashed[i]));
+
+    constexpr int BAR_WIDTH = 30;
+    printf("\n%s\n%16s  %-*s %8s   %-*s %8s\n", title, "", BAR_WIDTH, "landed", "", BAR_WIDTH, "crashed", "");
+    char range[32];
+    char bars[2][BAR_WIDTH + 1];
+    bool limit_shown = limit < 0.0;
+    for (int i = 0; i < bin_count; i++)
+    {
+        double from = i * bin_width;
+        if (!limit_shown && from >= limit - 1e-9)
+        {
+            printf("%16s  ---- limit %.*f ----\n", "", decimals, limit);
+            limit_shown = true;
+        }
+        if (i == bin_count - 1) snprintf(range, sizeof(range), "%.*f+", decimals, from);
+        else if (bin_width == 1.0) snprintf(range, sizeof(range), "%.0f", from);
+        else snprintf(range, sizeof(range), "%.*f-%.*f", decimals, from, decimals, from + bin_width);
+
+        const uint64_t counts[2] = { landed[i], crashed[i] };
+        for (int side = 0; side < 2; side++)
+        {
+            int length = (int)((counts[side] * BAR_WIDTH + most - 1) / most);
+            memset(bars[side], '#', length);
+            memset(bars[side] + length, ' ', BAR_WIDTH - length);
+            bars[side][BAR_WIDTH] = '\0';
+        }
+        printf("%16s  %s %8llu   %s %8llu\n", range, bars[0], (unsigned long long)landed[i], bars[1],
+            (unsigned long long)crashed[i]);
+    }
+}
+
+void print_grid(const std::vector<uint64_t>& grid, int width, int height)
+{
+    static const char SHADES[] = " .:-=+*#%@";
+    uint64_t most = 0;
+    for (uint64_t count : grid) most = std::max(most, count);
+
+    printf("\ncrash density, %dx%d over x %.2f..%.2f y %.2f..%.2f, '@' = %llu\n", width, height, WORLD_LEFT,
+        WORLD_RIGHT, WORLD_BOTTOM, WORLD_TOP, (unsigned long long)most);
+    printf("+%s+\n", std::string(width, '-').c_str());
+    for (int y = height - 1; y >= 0; y--)
+    {
+        std::string line(width, ' ');
+        for (int x = 0; x < width; x++)
+        {
+            uint64_t count = grid[(size_t)y * width + x];
+            // anything at all shows, the rest scales with the busiest cell
+            if (count > 0) line[x] = SHADES[1 + (int)((count - 1) * (sizeof(SHADES) - 3) / std::max<uint64_t>(most - 1, 1))];
+        }
+        printf("|%s|\n", line.c_str());
+    }
+    printf("+%s+\n", std::string(width, '-').c_str());
+}
+
+bool write_grid_csv(const char* filepath, const std::vector<uint64_t>& grid, int width, int height)
+{
+    FILE* file = fopen(filepath, "w");
+    if (file == nullptr) return false;
+
+    // top row first, like the picture
+    fprintf(file, "# crashes per cell, x %.2f..%.2f left to right, y %.2f..%.2f top to bottom\n", WORLD_LEFT,
+        WORLD_RIGHT, WORLD_TOP, WORLD_BOTTOM);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            fprintf(file, "%llu%s", (unsigned long long)grid[(size_t)y * width + x], x + 1 < width ? "," : "\n");
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int workers = (int)std::max(1u, std::thread::hardware_concurrency()) - 1;
+    int grid_width = 40;
+    int grid_height = 30;
+    int bench = 0;
+    const char* grid_csv_filepath = nullptr;
+    std::vector<const char*> filepaths;
+    bool usage_error = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) workers = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--grid") == 0 && i + 2 < argc)
+        {
+            grid_width = std::max(1, atoi(argv[++i]));
+            grid_height = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--grid-csv") == 0 && i + 1 < argc) grid_csv_filepath = argv[++i];
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) bench = std::max(0, atoi(argv[++i]));
+        else if (argv[i][0] != '-') filepaths.push_back(argv[i]);
+        else usage_error = true;
+    }
+
+    if (usage_error || filepaths.empty())
+    {
+        LOG("Usage: telemetry [--workers N] [--grid W H] [--grid-csv FILE] [--bench N] <file.telemetry>...");
+        return 1;
+    }
+
+    // every block there is right now, files still being written stop here
+    std::vector<TelemetryReader> readers(filepaths.size());
+    std::vector<Unit> units;
+    for (size_t i = 0; i < filepaths.size(); i++)
+    {
+        if (!readers[i].open(filepaths[i]))
+        {
+            LOG("Couldn't open " << filepaths[i] << " as telemetry");
+            return 1;
+        }
+        for (uint64_t block = 0; block < readers[i].get_block_count(); block++) units.push_back({ &readers[i], block });
+    }
+
+    // contiguous runs of blocks, so consecutive blocks of a file mostly stay on one thread
+    size_t task_count = std::max<size_t>(1, std::min(units.size(), (size_t)(workers + 1) * TASKS_PER_THREAD));
+    std::vector<ScanTask> tasks(task_count);
+    TaskGraph graph;
+    for (size_t i = 0; i < task_count; i++)
+    {
+        size_t begin = units.size() * i / task_count;
+        size_t end = units.size() * (i + 1) / task_count;
+        tasks[i].units = units.data() + begin;
+        tasks[i].unit_count = end - begin;
+        tasks[i].grid_width = grid_width;
+        tasks[i].grid_height = grid_height;
+        tasks[i].crash_grid.resize((size_t)grid_width * grid_height);
+        graph.add_task("scan telemetry", scan_task, &tasks[i]);
+    }
+    graph.start("telemetry", workers);
+
+    auto start = std::chrono::steady_clock::now();
+    graph.run();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    double scan_ms = elapsed.count();
+
+    if (bench > 0)
+    {
+        std::vector<double> times;
+        for (int i = 0; i < bench; i++)
+        {
+            start = std::chrono::steady_clock::now();
+            graph.run();
+            elapsed = std::chrono::steady_clock::now() - start;
+            times.push_back(elapsed.count());
+        }
+        std::sort(times.begin(), times.end());
+        scan_ms = times[times.size() / 2];
+    }
+    graph.shutdown();
+
+    Stats total = {};
+    std::vector<uint64_t> crash_grid((size_t)grid_width * grid_height, 0);
+    for (const ScanTask& task : tasks)
+    {
+        merge(total, task.stats);
+        for (size_t i = 0; i < crash_grid.size(); i++) crash_grid[i] += task.crash_grid[i];
+    }
+
+    // ----- REPORT ----- //
+    // platforms as the first file has them, every file comes from the same level
+    const TelemetryFileHeader& header = *readers[0].get_header();
+    uint64_t touchdowns = total.landings + total.crashes;
+    printf("%zu files, %zu blocks, %llu steps (%.1f%% active, %.1f%% of those thrusting)\n", filepaths.size(),
+        units.size(), (unsigned long long)total.ticks, percent(total.active_ticks, total.ticks),
+        percent(total.thrust_ticks, total.active_ticks));
+    printf("%llu touchdowns: %llu landed (%.1f%%), %llu crashed\n", (unsigned long long)touchdowns,
+        (unsigned long long)total.landings, percent(total.landings, touchdowns), (unsigned long long)total.crashes);
+
+    printf("\n%-10s %7s %7s %6s %6s %6s %11s %8s %8s\n", "platform", "x", "y", "width", "height", "enemy", "touchdowns",
+        "landed", "rate");
+    for (uint32_t i = 0; i <= header.platform_count; i++)
+    {
+        int platform = i < header.platform_count ? (int)i : TELEMETRY_MAX_PLATFORMS;
+        uint64_t count = total.touchdowns[platform];
+        uint64_t landed = total.platform_landings[platform];
+        if (platform == TELEMETRY_MAX_PLATFORMS)
+        {
+            printf("%-10s %7s %7s %6s %6s %6s %11llu %8llu %7.1f%%\n", "none", "", "", "", "", "",
+                (unsigned long long)count, (unsigned long long)landed, percent(landed, count));
+            continue;
+        }
+        const TelemetryPlatform& info = header.platforms[i];
+        printf("%-10u %7.2f %7.2f %6.2f %6.2f %6s %11llu %8llu %7.1f%%\n", i, info.x, info.y, info.width, info.height,
+            info.enemy ? "yes" : "no", (unsigned long long)count, (unsigned long long)landed, percent(landed, count));
+    }
+
+    printf("\ncrashes by what valid_collision() or the bounds check caught\n");
+    for (int i = 0; i < CRASH_REASON_COUNT; i++)
+    {
+        printf("  %-14s %8llu %6.1f%%\n", CRASH_REASON_NAMES[i], (unsigned long long)total.crash_reasons[i],
+            percent(total.crash_reasons[i], total.crashes));
+    }
+    printf("  %llu landings came in at or over the %.1f speed limit\n", (unsigned long long)total.fast_landings,
+        SPEED_LIMIT);
+
+    print_histogram("|velocity.x| the step before touchdown", total.speed_x[1], total.speed_x[0], SPEED_BINS,
+        SPEED_BIN_WIDTH, SPEED_LIMIT, 2);
+    print_histogram("|velocity.y| the step before touchdown", total.speed_y[1], total.speed_y[0], SPEED_BINS,
+        SPEED_BIN_WIDTH, SPEED_LIMIT, 2);
+    print_histogram("angle error at touchdown, degrees", total.angle_error[1], total.angle_error[0], ANGLE_BINS,
+        ANGLE_BIN_WIDTH, ANGLE_LIMIT + 1, 0);
+    print_histogram("fuel left at touchdown", total.fuel[1], total.fuel[0], FUEL_BINS, FUEL_BIN_WIDTH, -1.0, 0);
+    print_grid(crash_grid, grid_width, grid_height);
+
+    if (grid_csv_filepath != nullptr && !write_grid_csv(grid_csv_filepath, crash_grid, grid_width, grid_height))
+    {
+        LOG("Couldn't write " << grid_csv_filepath);
+        return 1;
+    }
+
+    printf("\nscanned in %.2f ms%s on %d threads, %.0f million steps a second\n", scan_ms, bench > 0 ? " (median)" : "",
+        workers + 1, scan_ms > 0.0 ? total.ticks / scan_ms / 1000.0 : 0.0);
+    return 0;
+}